@@ -0,0 +1,120 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <utility>
+#include <ostream>
+
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+using Params = std::vector<std::pair<std::string, long long>>;
+
+//! Measures time of a benchmark body, setup and teardown can be excluded with pause/resume
+class Timer
+{
+    Clock::time_point m_start;
+    Clock::duration m_elapsed = Clock::duration::zero();
+    bool m_running = false;
+public:
+    void resume()
+    {
+        if (!m_running) {
+            m_running = true;
+            m_start = Clock::now();
+        }
+    }
+
+    void pause()
+    {
+        if (m_running) {
+            m_elapsed += Clock::now() - m_start;
+            m_running = false;
+        }
+    }
+
+    double seconds() const
+    {
+        return std::chrono::duration<double>(m_elapsed).count();
+    }
+};
+
+struct Result
+{
+    std::string name;
+    Params params;
+    unsigned long long ops = 0;
+    double seconds = 0;
+};
+
+//! Collects results of all benchmarks of one run
+class Session
+{
+    bool m_quick = false;
+    double m_minTime = 0.2;
+    std::string m_filter;
+    std::vector<Result> m_results;
+
+public:
+    Session(bool quick, std::string filter)
+        : m_quick(quick)
+        , m_minTime(quick ? 0.02 : 0.2)
+        , m_filter(std::move(filter))
+    {}
+
+    // Quick mode uses smaller sizes and shorter runs (smoke checks)
+    bool quick() const { return m_quick; }
+
+    // Calls "fun(timer)" until at least minimal time is measured,
+    // "fun" returns a number of processed operations
+    template<class Fun>
+    void run(const std::string & name, Params params, Fun && fun)
+    {
+        if (!m_filter.empty() && name.find(m_filter) == std::string::npos)
+            return;
+
+        Result result{name, std::move(params)};
+        do {
+            Timer timer;
+            timer.resume();
+            result.ops += fun(timer);
+            timer.pause();
+            result.seconds += timer.seconds();
+        } while (result.seconds < m_minTime);
+
+        report(result);
+        m_results.push_back(std::move(result));
+    }
+
+    void write(std::ostream & out) const;
+
+private:
+    void report(const Result & result) const;
+};
+
+// Keeps a computed value alive, so the computation isn't optimized out
+template<class T>
+inline void doNotOptimize(const T & value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+using Suite = void (*)(Session &);
+
+std::vector<Suite> & suites();
+
+struct Registrar
+{
+    Registrar(Suite suite) { suites().push_back(suite); }
+};
+
+} // namespace bench
+
+#define BENCH_CONCAT_IMPL(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_IMPL(a, b)
+
+// Registers a function "void (bench::Session &)" as a benchmark suite
+#define BENCH_SUITE(fun) \
+    static bench::Registrar BENCH_CONCAT(benchRegistrar, __LINE__)(fun)
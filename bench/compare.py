@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+"""Compares two benchmark runs produced by `bench --out FILE.json`.
+
+Usage: compare.py BASELINE.json CANDIDATE.json [--threshold PERCENT]
+
+Prints throughput change for every benchmark present in both runs and exits
+with status 1 if any of them is slower than the baseline by more than the
+threshold (10% by default).
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    results = {}
+    for bench in data["benchmarks"]:
+        params = ",".join("%s=%s" % kv for kv in sorted(bench["params"].items()))
+        results[(bench["name"], params)] = bench
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two benchmark runs")
+    parser.add_argument("baseline")
+    parser.add_argument("candidate")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="allowed slowdown in percent (default: 10)")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    candidate = load(args.candidate)
+
+    regressions = 0
+    print("%-30s %-16s %14s %14s %9s" % ("benchmark", "params", "base ops/s", "new ops/s", "change"))
+    for key in sorted(baseline.keys() & candidate.keys()):
+        before = baseline[key]["ops_per_sec"]
+        after = candidate[key]["ops_per_sec"]
+        change = (after / before - 1.0) * 100.0
+        mark = ""
+        if change < -args.threshold:
+            mark = "  REGRESSION"
+            regressions += 1
+        print("%-30s %-16s %14.0f %14.0f %+8.1f%%%s" % (key[0], key[1], before, after, change, mark))
+
+    for key in sorted(baseline.keys() - candidate.keys()):
+        print("%-30s %-16s missing in candidate" % key)
+    for key in sorted(candidate.keys() - baseline.keys()):
+        print("%-30s %-16s new" % key)
+
+    if regressions:
+        print("%d benchmark(s) regressed by more than %.1f%%" % (regressions, args.threshold))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
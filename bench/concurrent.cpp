@@ -0,0 +1,144 @@
+#include <thread>
+
+#include <mvc/concurrent_controller.h>
+#include <mvc/sharded_controller.h>
+
+#include "bench.h"
+
+
+namespace {
+
+struct BenchModel
+{
+    int value = 0;
+};
+
+using BenchController = mvc::ConcurrentController<BenchModel>;
+
+void producers(bench::Session & session)
+{
+    const std::vector<long long> counts = session.quick()
+        ? std::vector<long long>{1, 4}
+        : std::vector<long long>{1, 2, 4, 8, 16, 32, 64};
+
+    // Every producer creates, updates and removes its share of models, one thread applies them
+    const long long models = 64 * 1024;
+    for (auto count : counts) {
+        session.run("concurrent_requests", {{"producers", count}}, [count, models](bench::Timer &) {
+            auto ctrl = std::make_shared<BenchController>();
+            std::thread owner([&ctrl] { ctrl->run(); });
+
+            std::vector<std::thread> threads;
+            for (long long p = 0; p < count; ++p) {
+                threads.emplace_back([&ctrl, share = models / count] {
+                    std::vector<BenchController::ModelPtrC> created;
+                    created.reserve(share);
+                    for (long long i = 0; i < share; ++i)
+                        created.push_back(ctrl->createRequest().toPtr());
+                    for (auto && model : created)
+                        ctrl->updateRequest(model)->value += 1;
+                    for (auto && model : created)
+                        ctrl->removeRequest(model);
+                });
+            }
+            for (auto && thread : threads)
+                thread.join();
+
+            ctrl->stop();
+            owner.join();
+            return models / count * count * 3;
+        });
+    }
+}
+
+void shards(bench::Session & session)
+{
+    const std::vector<long long> counts = session.quick()
+        ? std::vector<long long>{1, 2}
+        : std::vector<long long>{1, 2, 4, 8, 16};
+
+    // Eight producers update independent models, every shard has its own worker thread
+    const long long producers = 8;
+    const long long models = 8 * 1024;
+    for (auto count : counts) {
+        session.run("sharded_updates", {{"shards", count}}, [count, producers, models](bench::Timer & timer) {
+            timer.pause();
+            mvc::ShardedController<BenchModel> ctrl(count);
+            std::vector<std::vector<BenchController::ModelPtrC>> created(producers);
+            for (long long i = 0; i < models; ++i)
+                created[i % producers].push_back(ctrl.createRequest().toPtr());
+            ctrl.start();
+            timer.resume();
+
+            std::vector<std::thread> threads;
+            for (auto && share : created) {
+                threads.emplace_back([&ctrl, &share] {
+                    for (int round = 0; round < 4; ++round) {
+                        for (auto && model : share)
+                            ctrl.updateRequest(model)->value += 1;
+                    }
+                });
+            }
+            for (auto && thread : threads)
+                thread.join();
+            ctrl.stop();
+
+            timer.pause();
+            ctrl.start();
+            for (auto && share : created) {
+                for (auto && model : share)
+                    ctrl.removeRequest(model);
+            }
+            ctrl.stop();
+            return models * 4;
+        });
+    }
+}
+
+void shardedCreates(bench::Session & session)
+{
+    const std::vector<long long> counts = session.quick()
+        ? std::vector<long long>{1, 2}
+        : std::vector<long long>{1, 2, 4, 8, 16};
+
+    // Eight producers create models, the shard of a model is known only after it is allocated
+    const long long producers = 8;
+    const long long models = 8 * 1024;
+    for (auto count : counts) {
+        session.run("sharded_creates", {{"shards", count}}, [count, producers, models](bench::Timer & timer) {
+            timer.pause();
+            mvc::ShardedController<BenchModel> ctrl(count);
+            std::vector<std::vector<BenchController::ModelPtrC>> created(producers);
+            for (auto && share : created)
+                share.reserve(models / producers);
+            ctrl.start();
+            timer.resume();
+
+            std::vector<std::thread> threads;
+            for (auto && share : created) {
+                threads.emplace_back([&ctrl, &share, models, producers] {
+                    for (long long i = 0; i < models / producers; ++i)
+                        share.push_back(ctrl.createRequest().toPtr());
+                });
+            }
+            for (auto && thread : threads)
+                thread.join();
+            ctrl.stop();
+
+            timer.pause();
+            ctrl.start();
+            for (auto && share : created) {
+                for (auto && model : share)
+                    ctrl.removeRequest(model);
+            }
+            ctrl.stop();
+            return models / producers * producers;
+        });
+    }
+}
+
+BENCH_SUITE(producers);
+BENCH_SUITE(shards);
+BENCH_SUITE(shardedCreates);
+
+} // namespace
@@ -0,0 +1,749 @@
+#include <cstdio>
+#include <sstream>
+#include <algorithm>
+
+#include <mvc/view.h>
+#include <mvc/codec.h>
+#include <mvc/controller.h>
+#include <mvc/static_controller.h>
+
+#include "Models/Fwd.h"
+#include "Ctrls/PageLoader.h"
+
+#include "bench.h"
+
+
+namespace {
+
+struct BenchModel
+{
+    int value = 0;
+};
+
+using BenchController = mvc::Controller<BenchModel>;
+
+template<class Model>
+struct CountingView : mvc::View<Model>
+{
+    using BaseView = mvc::View<Model>;
+    using BaseView::BaseView;
+    using ModelPtrC = typename BaseView::ModelPtrC;
+
+    size_t calls = 0;
+
+protected:
+    void created(const ModelPtrC &) override { ++calls; }
+    void removed(const ModelPtrC &) override { ++calls; }
+    void updated(const ModelPtrC &, const ModelPtrC &) override { ++calls; }
+};
+
+template<class Model>
+struct StaticCountingView : mvc::StaticView<StaticCountingView<Model>, Model>
+{
+    using ModelPtrC = std::shared_ptr<const Model>;
+
+    size_t calls = 0;
+
+    void created(const ModelPtrC &) { ++calls; }
+    void removed(const ModelPtrC &) { ++calls; }
+    void updated(const ModelPtrC &, const ModelPtrC &) { ++calls; }
+};
+
+// Controller with Count static views
+template<class View, size_t>
+using Same = View;
+
+template<class Sequence>
+struct StaticFanout;
+
+template<size_t... Index>
+struct StaticFanout<std::index_sequence<Index...>>
+{
+    using Controller = mvc::StaticController<BenchModel, Same<StaticCountingView<BenchModel>, Index>...>;
+};
+
+template<size_t Count>
+using StaticBenchController = typename StaticFanout<std::make_index_sequence<Count>>::Controller;
+
+std::vector<long long> modelCounts(const bench::Session & session)
+{
+    if (session.quick())
+        return {1, 100, 10000};
+    return {1, 10, 100, 1000, 10000, 100000, 1000000};
+}
+
+std::vector<long long> viewCounts(const bench::Session & session)
+{
+    if (session.quick())
+        return {1, 100};
+    return {1, 10, 100, 1000, 10000};
+}
+
+std::vector<BenchController::ModelPtrC> createModels(BenchController & ctrl, long long count)
+{
+    std::vector<BenchController::ModelPtrC> models;
+    models.reserve(count);
+    for (long long i = 0; i < count; ++i) {
+        auto creator = ctrl.createRequest();
+        creator->value = static_cast<int>(i);
+        models.push_back(creator.toPtr());
+    }
+    return models;
+}
+
+void removeModels(BenchController & ctrl, const std::vector<BenchController::ModelPtrC> & models)
+{
+    for (auto && model : models)
+        ctrl.removeRequest(model);
+}
+
+void requests(bench::Session & session)
+{
+    for (auto count : modelCounts(session)) {
+        session.run("create", {{"models", count}}, [count](bench::Timer & timer) {
+            auto ctrl = std::make_shared<BenchController>();
+            auto models = createModels(*ctrl, count);
+            timer.pause();
+            removeModels(*ctrl, models);
+            return count;
+        });
+
+        session.run("create_batch", {{"models", count}}, [count](bench::Timer & timer) {
+            auto ctrl = std::make_shared<BenchController>();
+            std::vector<BenchController::ModelPtrC> models;
+            {
+                auto batch = ctrl->batch();
+                models = createModels(*ctrl, count);
+            }
+            timer.pause();
+            removeModels(*ctrl, models);
+            return count;
+        });
+
+        session.run("update", {{"models", count}}, [count](bench::Timer & timer) {
+            timer.pause();
+            auto ctrl = std::make_shared<BenchController>();
+            auto models = createModels(*ctrl, count);
+            timer.resume();
+            for (auto && model : models)
+                ctrl->updateRequest(model)->value += 1;
+            timer.pause();
+            removeModels(*ctrl, models);
+            return count;
+        });
+
+        session.run("update_pooled", {{"models", count}}, [count](bench::Timer & timer) {
+            timer.pause();
+            auto ctrl = std::make_shared<BenchController>(std::make_shared<mvc::PoolResource>());
+            auto models = createModels(*ctrl, count);
+            timer.resume();
+            for (auto && model : models)
+                ctrl->updateRequest(model)->value += 1;
+            timer.pause();
+            removeModels(*ctrl, models);
+            return count;
+        });
+
+        session.run("update_by_id", {{"models", count}}, [count](bench::Timer & timer) {
+            timer.pause();
+            auto ctrl = std::make_shared<BenchController>();
+            auto models = createModels(*ctrl, count);
+            std::vector<mvc::ModelId> ids;
+            ids.reserve(count);
+            for (auto && model : models)
+                ids.push_back(ctrl->idOf(model));
+            timer.resume();
+            for (auto id : ids)
+                ctrl->updateRequest(id)->value += 1;
+            timer.pause();
+            removeModels(*ctrl, models);
+            return count;
+        });
+
+        session.run("iterate_models", {{"models", count}}, [count](bench::Timer & timer) {
+            timer.pause();
+            auto ctrl = std::make_shared<BenchController>();
+            auto models = createModels(*ctrl, count);
+            timer.resume();
+            const long long rounds = std::max(1LL, 1000000 / count);
+            long long sum = 0;
+            for (long long i = 0; i < rounds; ++i) {
+                for (auto && model : ctrl->models())
+                    sum += model->value;
+            }
+            timer.pause();
+            bench::doNotOptimize(sum);
+            removeModels(*ctrl, models);
+            return rounds * count;
+        });
+
+        session.run("remove", {{"models", count}}, [count](bench::Timer & timer) {
+            timer.pause();
+            auto ctrl = std::make_shared<BenchController>();
+            auto models = createModels(*ctrl, count);
+            timer.resume();
+            removeModels(*ctrl, models);
+            return count;
+        });
+    }
+}
+
+void fanout(bench::Session & session)
+{
+    const long long updates = 1000;
+    for (auto count : viewCounts(session)) {
+        auto ctrl = std::make_shared<BenchController>();
+        std::vector<std::shared_ptr<CountingView<BenchModel>>> views;
+        for (long long i = 0; i < count; ++i)
+            views.push_back(std::make_shared<CountingView<BenchModel>>(ctrl));
+        auto model = createModels(*ctrl, 1).front();
+
+        session.run("notify_fanout", {{"views", count}}, [&](bench::Timer &) {
+            for (long long i = 0; i < updates; ++i)
+                ctrl->updateRequest(model)->value += 1;
+            return updates;
+        });
+
+        auto extra = std::make_shared<mvc::details::Observer<BenchModel>>();
+        session.run("attach_detach", {{"views", count}}, [&](bench::Timer &) {
+            const long long cycles = 1000;
+            for (long long i = 0; i < cycles; ++i)
+                ctrl->detach(ctrl->attach(extra));
+            return cycles;
+        });
+
+        ctrl->removeRequest(model);
+    }
+}
+
+struct LocalBenchModel
+{
+    using Ownership = mvc::LocalOwnership;
+    int value = 0;
+};
+
+template<class Model>
+void runOwnership(bench::Session & session, long long local)
+{
+    // Create, update and remove of models observed by two views
+    auto ctrl = std::make_shared<mvc::Controller<Model>>();
+    auto view1 = std::make_shared<CountingView<Model>>(ctrl);
+    auto view2 = std::make_shared<CountingView<Model>>(ctrl);
+
+    session.run("model_lifecycle", {{"local", local}}, [&](bench::Timer &) {
+        const long long count = 1000;
+        for (long long i = 0; i < count; ++i) {
+            typename mvc::Controller<Model>::ModelPtrC model;
+            {
+                auto creator = ctrl->createRequest();
+                creator->value = static_cast<int>(i);
+                model = creator.toPtr();
+            }
+            ctrl->updateRequest(model)->value += 1;
+            ctrl->removeRequest(model);
+        }
+        return count;
+    });
+}
+
+void ownership(bench::Session & session)
+{
+    runOwnership<BenchModel>(session, 0);
+    runOwnership<LocalBenchModel>(session, 1);
+}
+
+// Every view watches one model, it filters events itself or has a model subscription
+struct ModelWatcher : mvc::details::Observer<BenchModel>
+{
+    const BenchModel * watched = nullptr;
+    size_t calls = 0;
+
+    void updated(const ModelPtrC & model, const ModelPtrC &) override
+    {
+        if (model.get() == watched)
+            ++calls;
+    }
+};
+
+void scopedFanout(bench::Session & session)
+{
+    const long long updates = 1000;
+    for (auto count : viewCounts(session)) {
+        for (long long scoped : {0, 1}) {
+            BenchController ctrl;
+            auto models = createModels(ctrl, count);
+            std::vector<ModelWatcher> watchers(count);
+            for (long long i = 0; i < count; ++i) {
+                watchers[i].watched = models[i].get();
+                if (scoped)
+                    ctrl.attach(watchers[i], models[i]);
+                else
+                    ctrl.attach(watchers[i]);
+            }
+
+            session.run("notify_scoped", {{"views", count}, {"scoped", scoped}}, [&](bench::Timer &) {
+                for (long long i = 0; i < updates; ++i)
+                    ctrl.updateRequest(models[i % count])->value += 1;
+                return updates;
+            });
+
+            removeModels(ctrl, models);
+        }
+    }
+}
+
+struct ReflectedBenchModel
+{
+    int value = 0;
+    int progress = 0;
+
+    static auto fields() { return mvc::fields(&ReflectedBenchModel::value, &ReflectedBenchModel::progress); }
+};
+
+// Is interested in "progress" changes only
+struct ProgressWatcher : mvc::details::Observer<ReflectedBenchModel>
+{
+    size_t calls = 0;
+
+    void updated(const ModelPtrC & model, const ModelPtrC & from) override
+    {
+        if (model->progress != from->progress)
+            ++calls;
+    }
+};
+
+void fieldFanout(bench::Session & session)
+{
+    // Updates change "value", views watch "progress" by comparing states or by a field subscription
+    const long long updates = 1000;
+    for (auto count : viewCounts(session)) {
+        for (long long fields : {0, 1}) {
+            mvc::Controller<ReflectedBenchModel> ctrl;
+            std::vector<ProgressWatcher> watchers(count);
+            const auto progress = mvc::fieldMask(&ReflectedBenchModel::progress);
+            for (auto && watcher : watchers) {
+                if (fields)
+                    ctrl.attach(watcher, progress);
+                else
+                    ctrl.attach(watcher);
+            }
+            auto model = ctrl.createRequest().toPtr();
+
+            session.run("notify_fields", {{"views", count}, {"fields", fields}}, [&](bench::Timer &) {
+                for (long long i = 0; i < updates; ++i)
+                    ctrl.updateRequest(model)->value += 1;
+                return updates;
+            });
+
+            ctrl.removeRequest(model);
+        }
+    }
+}
+
+void noOpUpdates(bench::Session & session)
+{
+    // Idempotent writes: nine of ten updates assign the current value, two views observe them
+    for (long long suppress : {0, 1}) {
+        mvc::Controller<ReflectedBenchModel> ctrl;
+        ctrl.setOptions(suppress ? static_cast<unsigned>(mvc::Option::SuppressNoOpUpdates) : 0u);
+        ProgressWatcher view1, view2;
+        ctrl.attach(view1);
+        ctrl.attach(view2);
+        auto model = ctrl.createRequest().toPtr();
+
+        session.run("noop_updates", {{"suppress", suppress}}, [&](bench::Timer &) {
+            const long long updates = 10000;
+            for (long long i = 0; i < updates; ++i)
+                ctrl.updateRequest(model)->progress = static_cast<int>(i / 10);
+            return updates;
+        });
+
+        ctrl.removeRequest(model);
+    }
+}
+
+template<size_t Count>
+void runStaticFanout(bench::Session & session)
+{
+    const long long updates = 1000;
+    auto ctrl = std::make_shared<StaticBenchController<Count>>();
+    auto model = createModels(*ctrl, 1).front();
+
+    session.run("notify_fanout_static", {{"views", static_cast<long long>(Count)}}, [&](bench::Timer &) {
+        for (long long i = 0; i < updates; ++i)
+            ctrl->updateRequest(model)->value += 1;
+        return updates;
+    });
+
+    ctrl->removeRequest(model);
+}
+
+void staticFanout(bench::Session & session)
+{
+    // Same as notify_fanout, but the views are known at compile time
+    runStaticFanout<1>(session);
+    if (!session.quick())
+        runStaticFanout<10>(session);
+    runStaticFanout<100>(session);
+}
+
+void fusion(bench::Session & session)
+{
+    // Short-lived models created and removed in the same batch, observed by two views
+    for (long long fuse : {0, 1}) {
+        auto ctrl = std::make_shared<BenchController>();
+        ctrl->setOptions(fuse ? static_cast<unsigned>(mvc::Option::FuseEvents) : 0u);
+        auto view1 = std::make_shared<CountingView<BenchModel>>(ctrl);
+        auto view2 = std::make_shared<CountingView<BenchModel>>(ctrl);
+
+        session.run("short_lived_batch", {{"fuse", fuse}}, [&](bench::Timer &) {
+            const long long count = 1000;
+            auto batch = ctrl->batch();
+            for (long long i = 0; i < count; ++i) {
+                BenchController::ModelPtrC model;
+                {
+                    auto creator = ctrl->createRequest();
+                    creator->value = static_cast<int>(i);
+                    model = creator.toPtr();
+                }
+                ctrl->updateRequest(model)->value += 1;
+                ctrl->removeRequest(model);
+            }
+            return count;
+        });
+
+        // Removals of existing models, which have nothing queued to cancel
+        session.run("remove_batch", {{"fuse", fuse}}, [&](bench::Timer & timer) {
+            const long long count = 10000;
+            timer.pause();
+            auto models = createModels(*ctrl, count);
+            timer.resume();
+            auto batch = ctrl->batch();
+            for (auto && model : models)
+                ctrl->removeRequest(model);
+            return count;
+        });
+    }
+}
+
+void runCascade(bench::Session & session, const std::string & name, long long views, unsigned options)
+{
+    auto ctrl = std::make_shared<Ctrls::PageLoader>();
+    ctrl->setOptions(options);
+    std::vector<std::shared_ptr<CountingView<Models::Page>>> observers;
+    for (long long i = 0; i < views; ++i)
+        observers.push_back(std::make_shared<CountingView<Models::Page>>(ctrl));
+
+    session.run(name, {{"views", views}}, [&](bench::Timer & timer) {
+        const long long pages = 1000;
+        std::vector<Models::PagePtrC> created;
+        created.reserve(pages);
+        for (long long i = 0; i < pages; ++i) {
+            auto creator = ctrl->createRequest();
+            creator->url = "www.example.com";
+            created.push_back(creator.toPtr());
+        }
+        timer.pause();
+        for (auto && page : created)
+            ctrl->removeRequest(page);
+        return pages;
+    });
+}
+
+void cascade(bench::Session & session)
+{
+    // Every created page runs the PageLoader progress loop: a create and six reentrant updates
+    for (long long views : {0, 2}) {
+        runCascade(session, "page_loader_cascade", views, 0);
+        runCascade(session, "page_loader_cascade_arena", views, mvc::Option::CascadeArena);
+        runCascade(session, "page_loader_cascade_coalesce", views, mvc::Option::CoalesceUpdates);
+    }
+}
+
+void lookup(bench::Session & session)
+{
+    // Finding pages by url, a scan of the model set against the hash index
+    std::vector<long long> counts = {100, 10000};
+    if (!session.quick())
+        counts.push_back(100000);
+    for (auto count : counts) {
+        for (long long indexed : {0, 1}) {
+            mvc::Controller<Models::Page> ctrl;
+            const mvc::HashIndex<Models::Page, std::string> * index = nullptr;
+            if (indexed)
+                index = &ctrl.addIndex(&Models::Page::url);
+            std::vector<Models::PagePtrC> pages;
+            for (long long i = 0; i < count; ++i) {
+                auto creator = ctrl.createRequest();
+                creator->url = "www.example.com/" + std::to_string(i);
+                pages.push_back(creator.toPtr());
+            }
+
+            session.run("find_by_url", {{"models", count}, {"indexed", indexed}}, [&](bench::Timer &) {
+                const long long lookups = indexed ? 10000 : std::max(1LL, 1000000 / count);
+                size_t found = 0;
+                for (long long i = 0; i < lookups; ++i) {
+                    const auto url = "www.example.com/" + std::to_string((i * 7919) % count);
+                    if (index) {
+                        found += index->find(url) != nullptr;
+                        continue;
+                    }
+                    for (auto && page : ctrl.models()) {
+                        if (page->url == url) {
+                            ++found;
+                            break;
+                        }
+                    }
+                }
+                bench::doNotOptimize(found);
+                return lookups;
+            });
+
+            for (auto && page : pages)
+                ctrl.removeRequest(page);
+        }
+    }
+}
+
+void startup(bench::Session & session)
+{
+    // Rebuilding a model set: one create request per page against loading a snapshot
+    struct CreatedCounter : mvc::details::Observer<Models::Page>
+    {
+        size_t calls = 0;
+        void created(const ModelPtrC &) override { ++calls; }
+    };
+
+    const std::string path = "bench_snapshot.bin";
+    std::vector<long long> counts = {10000};
+    if (!session.quick())
+        counts.push_back(100000);
+    for (auto count : counts) {
+        auto fill = [count](mvc::Controller<Models::Page> & ctrl) {
+            for (long long i = 0; i < count; ++i) {
+                auto creator = ctrl.createRequest();
+                creator->url = "www.example.com/" + std::to_string(i);
+                creator->content = "<html>" + std::to_string(i) + "</html>";
+                creator->loadingProgress = static_cast<int>(i % 100);
+            }
+        };
+        auto clear = [](mvc::Controller<Models::Page> & ctrl) {
+            auto batch = ctrl.batch();
+            for (auto && page : ctrl.models())
+                ctrl.removeRequest(page);
+        };
+        {
+            mvc::Controller<Models::Page> source;
+            fill(source);
+            source.saveSnapshot(path);
+            clear(source);
+        }
+        for (long long snapshot : {0, 1}) {
+            mvc::Controller<Models::Page> ctrl;
+            CreatedCounter view;
+            ctrl.attach(view);
+
+            session.run("startup", {{"models", count}, {"snapshot", snapshot}}, [&](bench::Timer & timer) {
+                if (snapshot)
+                    ctrl.loadSnapshot(path);
+                else
+                    fill(ctrl);
+                timer.pause();
+                clear(ctrl);
+                return count;
+            });
+        }
+    }
+    std::remove(path.c_str());
+}
+
+void checkpoints(bench::Session & session)
+{
+    // Background checkpoints: the pause of the controller (models captured per second),
+    // bytes written per second, and updates applied while a checkpoint is written
+    const std::string path = "bench_checkpoint.bin";
+    const long long count = session.quick() ? 10000 : 100000;
+    mvc::Controller<Models::Page> ctrl;
+    std::vector<Models::PagePtrC> pages;
+    for (long long i = 0; i < count; ++i) {
+        auto creator = ctrl.createRequest();
+        creator->url = "www.example.com/" + std::to_string(i);
+        creator->content = "<html>" + std::to_string(i) + "</html>";
+        pages.push_back(creator.toPtr());
+    }
+
+    session.run("checkpoint_pause", {{"models", count}}, [&](bench::Timer & timer) {
+        ctrl.checkpoint(path);
+        timer.pause();
+        ctrl.waitCheckpoint();
+        return count;
+    });
+
+    session.run("checkpoint_write", {{"models", count}}, [&](bench::Timer &) {
+        ctrl.checkpoint(path);
+        return static_cast<long long>(ctrl.waitCheckpoint().bytes);
+    });
+
+    for (long long checkpoint : {0, 1}) {
+        session.run("update_during_checkpoint", {{"models", count}, {"checkpoint", checkpoint}},
+                    [&](bench::Timer & timer) {
+            if (checkpoint)
+                ctrl.checkpoint(path);
+            for (long long i = 0; i < count; ++i)
+                ctrl.updateRequest(pages[static_cast<size_t>(i)])->loadingProgress = static_cast<int>(i);
+            timer.pause();
+            ctrl.waitCheckpoint();
+            return count;
+        });
+    }
+
+    auto batch = ctrl.batch();
+    for (auto && page : pages)
+        ctrl.removeRequest(page);
+    std::remove(path.c_str());
+}
+
+void journal(bench::Session & session)
+{
+    // Journaled updates by sync policy (0 never, 1 every drain, 2 interval), one update
+    // per drain or a hundred per batch (group commit), and records replayed per second
+    const std::string path = "bench_journal.bin";
+    const long long count = 1000;
+    using Sync = mvc::JournalOptions::Sync;
+    for (long long sync : {0, 1, 2}) {
+        for (long long perBatch : {1, 100}) {
+            std::remove(path.c_str());
+            mvc::Controller<Models::Page> ctrl;
+            std::vector<Models::PagePtrC> pages;
+            for (long long i = 0; i < count; ++i)
+                pages.push_back(ctrl.createRequest().toPtr());
+            mvc::JournalOptions options;
+            options.sync = static_cast<Sync>(sync);
+            ctrl.openJournal(path, options);
+
+            session.run("journal_update", {{"sync", sync}, {"batch", perBatch}}, [&](bench::Timer &) {
+                for (long long i = 0; i < count; i += perBatch) {
+                    auto batch = ctrl.batch();
+                    for (long long j = i; j < i + perBatch; ++j)
+                        ctrl.updateRequest(pages[static_cast<size_t>(j)])->loadingProgress += 1;
+                }
+                return count;
+            });
+
+            ctrl.closeJournal();
+            auto batch = ctrl.batch();
+            for (auto && page : pages)
+                ctrl.removeRequest(page);
+        }
+    }
+
+    // a journal of creations and ten updates of every model
+    const long long models = session.quick() ? 1000 : 10000;
+    std::remove(path.c_str());
+    {
+        mvc::Controller<Models::Page> ctrl;
+        ctrl.openJournal(path);
+        std::vector<Models::PagePtrC> pages;
+        for (long long i = 0; i < models; ++i) {
+            auto creator = ctrl.createRequest();
+            creator->url = "www.example.com/" + std::to_string(i);
+            pages.push_back(creator.toPtr());
+        }
+        for (int update = 0; update < 10; ++update) {
+            auto batch = ctrl.batch();
+            for (auto && page : pages)
+                ctrl.updateRequest(page)->loadingProgress = update;
+        }
+        ctrl.closeJournal();
+        auto batch = ctrl.batch();
+        for (auto && page : pages)
+            ctrl.removeRequest(page);
+    }
+
+    session.run("journal_replay", {{"models", models}, {"records", models * 11}}, [&](bench::Timer & timer) {
+        mvc::Controller<Models::Page> ctrl;
+        ctrl.openJournal(path);
+        ctrl.closeJournal();
+        timer.pause();
+        auto batch = ctrl.batch();
+        for (auto && page : ctrl.models())
+            ctrl.removeRequest(page);
+        return models * 11;
+    });
+    std::remove(path.c_str());
+}
+
+void codec(bench::Session & session)
+{
+    // Encoding of pages into one buffer, decoding them into models and reading two fields
+    // in place, against writing the same fields with std::ostringstream
+    const long long count = 10000;
+    std::vector<Models::Page> pages(static_cast<size_t>(count));
+    for (long long i = 0; i < count; ++i) {
+        auto & page = pages[static_cast<size_t>(i)];
+        page.url = "www.example.com/" + std::to_string(i);
+        page.content = "<html>" + std::string(static_cast<size_t>(i % 200), 'x') + "</html>";
+        page.loadingProgress = static_cast<int>(i % 100);
+    }
+
+    std::vector<char> buffer;
+    session.run("codec_encode", {}, [&](bench::Timer &) {
+        buffer.clear();
+        for (auto && page : pages)
+            mvc::encode(buffer, page);
+        bench::doNotOptimize(buffer.size());
+        return count;
+    });
+
+    session.run("iostream_encode", {}, [&](bench::Timer &) {
+        std::ostringstream out;
+        for (auto && page : pages) {
+            out << page.url << '\n' << page.content.get() << '\n'
+                << static_cast<int>(page.status) << ' ' << page.loadingProgress << '\n';
+        }
+        bench::doNotOptimize(out.str().size());
+        return count;
+    });
+
+    session.run("codec_decode", {}, [&](bench::Timer &) {
+        Models::Page page;
+        const char * pos = buffer.data();
+        for (long long i = 0; i < count; ++i) {
+            mvc::RecordView<Models::Page> record(pos, buffer.size() - static_cast<size_t>(pos - buffer.data()));
+            record.decode(page);
+            pos += record.size();
+        }
+        bench::doNotOptimize(page.loadingProgress);
+        return count;
+    });
+
+    session.run("codec_view", {}, [&](bench::Timer &) {
+        size_t sum = 0;
+        const char * pos = buffer.data();
+        for (long long i = 0; i < count; ++i) {
+            mvc::RecordView<Models::Page> record(pos, buffer.size() - static_cast<size_t>(pos - buffer.data()));
+            sum += record.get(&Models::Page::url).size;
+            sum += static_cast<size_t>(record.get(&Models::Page::loadingProgress));
+            pos += record.size();
+        }
+        bench::doNotOptimize(sum);
+        return count;
+    });
+}
+
+BENCH_SUITE(requests);
+BENCH_SUITE(fanout);
+BENCH_SUITE(staticFanout);
+BENCH_SUITE(scopedFanout);
+BENCH_SUITE(fieldFanout);
+BENCH_SUITE(noOpUpdates);
+BENCH_SUITE(cascade);
+BENCH_SUITE(fusion);
+BENCH_SUITE(ownership);
+BENCH_SUITE(lookup);
+BENCH_SUITE(startup);
+BENCH_SUITE(checkpoints);
+BENCH_SUITE(journal);
+BENCH_SUITE(codec);
+
+} // namespace
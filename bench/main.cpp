@@ -0,0 +1,76 @@
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "bench.h"
+
+
+namespace bench {
+
+std::vector<Suite> & suites()
+{
+    static std::vector<Suite> instance;
+    return instance;
+}
+
+void Session::report(const Result & result) const
+{
+    std::cerr << std::left << std::setw(30) << result.name;
+    for (auto && param : result.params)
+        std::cerr << ' ' << param.first << '=' << std::setw(8) << param.second;
+    std::cerr << std::right << std::setw(14) << std::fixed << std::setprecision(0)
+        << result.ops / result.seconds << " ops/s" << std::endl;
+}
+
+void Session::write(std::ostream & out) const
+{
+    out << "{\n  \"benchmarks\": [";
+    for (size_t i = 0; i < m_results.size(); ++i) {
+        const auto & result = m_results[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": \"" << result.name << "\", \"params\": {";
+        for (size_t j = 0; j < result.params.size(); ++j) {
+            out << (j ? ", " : "") << '"' << result.params[j].first << "\": "
+                << result.params[j].second;
+        }
+        out << std::setprecision(9) << std::defaultfloat
+            << "}, \"ops\": " << result.ops
+            << ", \"seconds\": " << result.seconds
+            << ", \"ops_per_sec\": " << result.ops / result.seconds
+            << ", \"ns_per_op\": " << result.seconds * 1e9 / result.ops << '}';
+    }
+    out << "\n  ]\n}\n";
+}
+
+} // namespace bench
+
+
+int main(int argc, char ** argv)
+{
+    bool quick = false;
+    std::string filter;
+    std::string output;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--quick"))
+            quick = true;
+        else if (!std::strcmp(argv[i], "--filter") && i + 1 < argc)
+            filter = argv[++i];
+        else if (!std::strcmp(argv[i], "--out") && i + 1 < argc)
+            output = argv[++i];
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--quick] [--filter NAME] [--out FILE.json]" << std::endl;
+            return 1;
+        }
+    }
+
+    bench::Session session(quick, filter);
+    for (auto suite : bench::suites())
+        suite(session);
+
+    if (output.empty()) {
+        session.write(std::cout);
+    } else {
+        std::ofstream file(output);
+        session.write(file);
+    }
+}
@@ -2,17 +2,25 @@
 
 #include <string>
 
+#include <mvc/cow.h>
+#include <mvc/reflection.h>
+
 
 namespace Models {
 
 struct Page
 {
     std::string url;
-    std::string content;
+    mvc::Cow<std::string> content; // shared by drafts until it is changed
     enum class Status {
         Created, Loading, Loaded
     } status = Status::Created;
     int loadingProgress = 0;
+
+    static auto fields()
+    {
+        return mvc::fields(&Page::url, &Page::content, &Page::status, &Page::loadingProgress);
+    }
 };
 
 } // namespace Models
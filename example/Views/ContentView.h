@@ -36,7 +36,7 @@ protected:
     void updated(const ModelPtrC & model, const ModelPtrC &) override
     {
         if (model->status == Models::Page::Status::Loaded)
-            std::cout << "Page content: " << model->content << std::endl;
+            std::cout << "Page content: " << *model->content << std::endl;
     }
 
 private:
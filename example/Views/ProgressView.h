@@ -19,9 +19,10 @@ public:
     using BaseView::BaseView;
 
 protected:
-    void updated(const ModelPtrC & model, const ModelPtrC & from) override
+    void updated(const ModelPtrC & model, const ModelPtrC &, mvc::ChangeMask changes) override
     {
-        if (model->loadingProgress != from->loadingProgress)
+        static const auto progress = mvc::fieldMask(&Models::Page::loadingProgress);
+        if (changes & progress)
             std::cout << "Loading progress: " << model->loadingProgress << "%" << std::endl;
     }
 };
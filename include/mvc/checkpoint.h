@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+#include "model_set.h"
+#include "snapshot.h"
+
+
+namespace mvc {
+
+//! Result of a background checkpoint, see Controller::checkpoint
+struct CheckpointStats
+{
+    bool ok = false;         // the snapshot file is written
+    size_t models = 0;
+    size_t preserved = 0;    // models copied because they were updated before they were written
+    uint64_t bytes = 0;
+    std::chrono::nanoseconds pause{0};    // the controller was blocked to capture the model set
+    std::chrono::nanoseconds duration{0}; // from the capture to the written file
+
+    // Bytes written per second
+    double throughput() const
+    {
+        const auto seconds = std::chrono::duration<double>(duration).count();
+        return seconds > 0 ? static_cast<double>(bytes) / seconds : 0;
+    }
+};
+
+namespace details {
+
+// Point-in-time image of a model set which is written by a background thread while the
+// controller goes on changing models. The image holds pointers to the models (removed
+// ones stay alive), a model which is going to be changed in place before the writer gets
+// to it is copied first. Each model has a state which the writer and the controller claim
+// with a compare-and-swap, so the writer reads either the untouched model or its copy.
+// Pointers are copied and released on the controller thread only.
+template<class Model>
+class Checkpoint
+{
+public:
+    using ModelPtrC = typename ModelPtrTraits<Model>::PtrC;
+
+    Checkpoint(const ModelSet<Model> & models, std::string path)
+        : m_path(std::move(path))
+        , m_start(std::chrono::steady_clock::now())
+        , m_models(models.begin(), models.end())
+        , m_copies(m_models.size())
+        , m_states(new std::atomic<uint8_t>[m_models.size()]())
+    {
+        for (size_t i = 0; i < m_models.size(); ++i) {
+            const auto slot = models.idAt(i).index;
+            if (slot >= m_positions.size())
+                m_positions.resize(slot + 1, NoPosition);
+            m_positions[slot] = static_cast<uint32_t>(i);
+        }
+        m_stats.models = m_models.size();
+        m_stats.pause = std::chrono::steady_clock::now() - m_start;
+        m_thread = std::thread([this]{ write(); });
+    }
+
+    ~Checkpoint() { wait(); }
+
+    Checkpoint(const Checkpoint &) = delete;
+    Checkpoint & operator =(const Checkpoint &) = delete;
+
+    bool finished() const { return m_finished.load(std::memory_order_acquire); }
+
+    const CheckpointStats & wait()
+    {
+        if (m_thread.joinable())
+            m_thread.join();
+        return m_stats;
+    }
+
+    // Is called before the model is changed in place, returns true if the writer needs
+    // a copy of its current state, it is passed to "preserve"
+    bool claim(ModelId id, const Model * model)
+    {
+        if (id.index >= m_positions.size() || m_positions[id.index] == NoPosition)
+            return false;
+        const size_t position = m_positions[id.index];
+        if (m_models[position].get() != model)
+            return false; // created after the capture in a reused slot
+
+        auto & state = m_states[position];
+        uint8_t expected = Pending;
+        if (state.compare_exchange_strong(expected, Claimed, std::memory_order_acq_rel)) {
+            m_claimed = position;
+            return true;
+        }
+        // the writer is reading the model, which takes one record
+        while (state.load(std::memory_order_acquire) == Writing)
+            std::this_thread::yield();
+        return false;
+    }
+
+    void preserve(ModelPtrC copy)
+    {
+        m_copies[m_claimed] = std::move(copy);
+        m_states[m_claimed].store(Preserved, std::memory_order_release);
+    }
+
+private:
+    enum : uint8_t { Pending, Writing, Written, Claimed, Preserved };
+    enum : uint32_t { NoPosition = UINT32_MAX };
+
+    void write()
+    {
+        size_t preserved = 0;
+        m_stats.ok = writeSnapshot<Model>(m_path, [this, &preserved](auto && fun) {
+            for (size_t i = 0; i < m_models.size(); ++i) {
+                auto & state = m_states[i];
+                uint8_t expected = Pending;
+                if (state.compare_exchange_strong(expected, Writing, std::memory_order_acq_rel)) {
+                    fun(*m_models[i]);
+                    state.store(Written, std::memory_order_release);
+                    continue;
+                }
+                while (state.load(std::memory_order_acquire) != Preserved)
+                    std::this_thread::yield();
+                fun(*m_copies[i]);
+                ++preserved;
+            }
+        }, &m_stats.bytes);
+        m_stats.preserved = preserved;
+        m_stats.duration = std::chrono::steady_clock::now() - m_start;
+        m_finished.store(true, std::memory_order_release);
+    }
+
+private:
+    std::string m_path;
+    std::chrono::steady_clock::time_point m_start;
+    std::vector<ModelPtrC> m_models;
+    std::vector<ModelPtrC> m_copies;
+    std::unique_ptr<std::atomic<uint8_t>[]> m_states;
+    std::vector<uint32_t> m_positions; // position in m_models of every slot of the model set
+    size_t m_claimed = 0;
+    CheckpointStats m_stats;
+    std::atomic<bool> m_finished{false};
+    std::thread m_thread;
+};
+
+} // namespace details
+} // namespace mvc
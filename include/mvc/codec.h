@@ -0,0 +1,498 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <type_traits>
+
+#include "cow.h"
+#include "reflection.h"
+#include "details/traits.h"
+
+
+namespace mvc {
+
+//! Binary encoding of models and of their creations, updates and removals, shared by
+//! snapshots and journals. A record is read in place: fields are taken from the buffer
+//! without decoding the whole record and without allocations.
+//!
+//! Model record:  size (32 bits) | slots of the fields | variable data
+//! Every encoded field has a slot of a fixed size, in the order of the field list, so the
+//! position of a field is known without parsing. A value of a variable size (a string)
+//! lives after the slots, its slot has the offset from the start of the record and the
+//! size (32 bits each). A record of an update has slots of the changed fields only.
+//!
+//! Event record:  type (8 bits) | key (64 bits) | [mask (64 bits), for updates] | [model record]
+//! Creations have a record with all fields, updates with the fields of the mask.
+//!
+//! Numbers are in the byte order of the machine and slots aren't aligned. Sizes and offsets
+//! are 32 bits, a model which doesn't fit into 4 GiB isn't encoded.
+
+//! Characters of a string field of an encoded record
+struct StringRef
+{
+    const char * data = nullptr;
+    size_t size = 0;
+
+    std::string str() const { return std::string(data, size); }
+    operator std::string() const { return str(); }
+
+    friend bool operator ==(const StringRef & l, const StringRef & r)
+    {
+        return l.size == r.size && std::memcmp(l.data, r.data, l.size) == 0;
+    }
+    friend bool operator !=(const StringRef & l, const StringRef & r) { return !(l == r); }
+    friend bool operator ==(const StringRef & l, const std::string & r) { return l == StringRef{r.data(), r.size()}; }
+    friend bool operator ==(const std::string & l, const StringRef & r) { return r == l; }
+};
+
+namespace details {
+
+constexpr size_t RecordHeaderSize = sizeof(uint32_t);
+
+// Appends a record to a buffer, the slots are reserved in advance
+class RecordWriter
+{
+public:
+    RecordWriter(std::vector<char> & buffer, size_t slotsSize)
+        : m_buffer(buffer)
+        , m_start(buffer.size())
+        , m_slot(m_start + RecordHeaderSize)
+    {
+        m_buffer.resize(m_slot + slotsSize);
+    }
+
+    // Fills the next slot
+    void fixed(const void * data, size_t size)
+    {
+        std::memcpy(m_buffer.data() + m_slot, data, size);
+        m_slot += size;
+    }
+
+    // Appends the data and fills the next slot with its offset and size. They are
+    // truncated to 32 bits when the record is too large, "finish" drops such a record
+    void variable(const void * data, size_t size)
+    {
+        const uint32_t slot[2] = {static_cast<uint32_t>(m_buffer.size() - m_start), static_cast<uint32_t>(size)};
+        fixed(slot, sizeof(slot));
+        auto bytes = static_cast<const char *>(data);
+        m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+    }
+
+    // Writes the size of the record, returns false and removes the record if the size
+    // (and so an offset or a size of its data) doesn't fit into 32 bits
+    bool finish()
+    {
+        const size_t size = m_buffer.size() - m_start;
+        if (size > UINT32_MAX) {
+            m_buffer.resize(m_start);
+            return false;
+        }
+        const auto size32 = static_cast<uint32_t>(size);
+        std::memcpy(m_buffer.data() + m_start, &size32, sizeof(size32));
+        return true;
+    }
+
+private:
+    std::vector<char> & m_buffer;
+    size_t m_start;
+    size_t m_slot;
+};
+
+template<class T>
+struct DependentFalse : std::false_type {};
+
+} // namespace details
+
+//! Range of the values of an enum field, values out of it are rejected when a record is read:
+//!     template<> struct mvc::EnumRange<Status> { static constexpr Status min = Status::Idle, max = Status::Done; };
+//! A scoped enum without a range accepts every value of its underlying type, an unscoped
+//! enum isn't encoded without one
+template<class T>
+struct EnumRange {};
+
+//! A trivially copyable class opts in to be copied into its slot as it is:
+//!     template<> struct mvc::TriviallyEncoded<Point> : std::true_type {};
+//! Its bytes are loaded back without checks, so every bit pattern of its members must be
+//! a valid value: no pointers, no bool and no enum members unless files are trusted
+template<class T>
+struct TriviallyEncoded : std::false_type {};
+
+namespace details {
+
+template<class T, class = void>
+struct HasEnumRange : std::false_type {};
+
+template<class T>
+struct HasEnumRange<T, VoidT<decltype(EnumRange<T>::min), decltype(EnumRange<T>::max)>> : std::true_type {};
+
+template<class T>
+constexpr bool isScopedEnum()
+{
+    return std::is_enum<T>::value && !std::is_convertible<T, std::underlying_type_t<T>>::value;
+}
+
+// Value copied into its slot
+template<class T>
+struct BytesCodec
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types are copied");
+
+    using View = T;
+    static constexpr size_t SlotSize = sizeof(T);
+
+    // The kind of the type with its size and alignment, so fields of the same size but of
+    // another type (int and float, signed and unsigned) don't match. Classes are told apart
+    // by their size and alignment only
+    static constexpr uint64_t signature()
+    {
+        return sizeof(T) | (uint64_t(1) << 32) |
+               (uint64_t(std::is_floating_point<T>::value) << 40) |
+               (uint64_t(std::is_signed<T>::value) << 41) |
+               (uint64_t(std::is_enum<T>::value) << 42) |
+               (uint64_t(std::is_same<T, bool>::value) << 43) |
+               (uint64_t(std::is_class<T>::value) << 44) |
+               (uint64_t(alignof(T)) << 48);
+    }
+
+    static void write(details::RecordWriter & out, const T & value) { out.fixed(&value, sizeof(T)); }
+    static View view(const char * /*record*/, const char * slot)
+    {
+        T value;
+        std::memcpy(&value, slot, sizeof(T));
+        return value;
+    }
+    static void assign(T & field, const View & view) { field = view; }
+};
+
+} // namespace details
+
+//! Encoding of one field type. Numbers and enums are copied into their slots, bool and
+//! enums are checked when a record is read, std::string is variable data read as StringRef,
+//! Cow<T> is encoded as T. Pointers aren't encoded, their values mean nothing in another
+//! process, and classes are encoded by a specialization or opt in by mvc::TriviallyEncoded.
+//! A specialization has the same members, "signature" must differ from signatures of other
+//! types and change whenever the encoding changes, "valid" accepts only slots which are
+//! read into valid values.
+template<class T, class = void>
+struct FieldCodec
+{
+    static_assert(details::DependentFalse<T>::value,
+                  "mvc::FieldCodec isn't specialized for the field type (pointers aren't encoded, "
+                  "plain classes opt in with mvc::TriviallyEncoded)");
+};
+
+template<class T>
+struct FieldCodec<T, std::enable_if_t<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>>
+    : details::BytesCodec<T>
+{
+    static bool valid(const char * /*slot*/, size_t /*recordSize*/) { return true; }
+};
+
+template<>
+struct FieldCodec<bool> : details::BytesCodec<bool>
+{
+    static_assert(sizeof(bool) == 1, "bool is expected to be a byte");
+
+    // other bytes aren't values of bool
+    static bool valid(const char * slot, size_t /*recordSize*/)
+    {
+        return static_cast<unsigned char>(*slot) <= 1;
+    }
+};
+
+template<class T>
+struct FieldCodec<T, std::enable_if_t<std::is_enum<T>::value>> : details::BytesCodec<T>
+{
+    static_assert(details::isScopedEnum<T>() || details::HasEnumRange<T>::value,
+                  "An unscoped enum needs mvc::EnumRange, not every value of its underlying type is its value");
+
+    static bool valid(const char * slot, size_t recordSize)
+    {
+        using Underlying = std::underlying_type_t<T>;
+        if (!FieldCodec<Underlying>::valid(slot, recordSize))
+            return false;
+        Underlying value;
+        std::memcpy(&value, slot, sizeof(value));
+        return inRange(value, details::HasEnumRange<T>());
+    }
+
+private:
+    template<class Underlying>
+    static bool inRange(Underlying value, std::true_type)
+    {
+        return static_cast<Underlying>(EnumRange<T>::min) <= value && value <= static_cast<Underlying>(EnumRange<T>::max);
+    }
+    template<class Underlying>
+    static bool inRange(Underlying, std::false_type) { return true; }
+};
+
+template<class T>
+struct FieldCodec<T, std::enable_if_t<std::is_class<T>::value && TriviallyEncoded<T>::value>>
+    : details::BytesCodec<T>
+{
+    static bool valid(const char * /*slot*/, size_t /*recordSize*/) { return true; }
+};
+
+template<>
+struct FieldCodec<std::string>
+{
+    using View = StringRef;
+    static constexpr size_t SlotSize = 2 * sizeof(uint32_t);
+
+    static constexpr uint64_t signature() { return uint64_t(2) << 32; }
+
+    static void write(details::RecordWriter & out, const std::string & value)
+    {
+        out.variable(value.data(), value.size());
+    }
+
+    static bool valid(const char * slot, size_t recordSize)
+    {
+        uint32_t location[2];
+        std::memcpy(location, slot, sizeof(location));
+        return location[0] <= recordSize && location[1] <= recordSize - location[0];
+    }
+
+    static View view(const char * record, const char * slot)
+    {
+        uint32_t location[2];
+        std::memcpy(location, slot, sizeof(location));
+        return {record + location[0], location[1]};
+    }
+
+    static void assign(std::string & field, const View & view) { field.assign(view.data, view.size); }
+};
+
+template<class T>
+struct FieldCodec<Cow<T>>
+{
+    using View = typename FieldCodec<T>::View;
+    static constexpr size_t SlotSize = FieldCodec<T>::SlotSize;
+
+    static constexpr uint64_t signature() { return FieldCodec<T>::signature(); }
+
+    static void write(details::RecordWriter & out, const Cow<T> & value)
+    {
+        FieldCodec<T>::write(out, value.get());
+    }
+
+    static bool valid(const char * slot, size_t recordSize) { return FieldCodec<T>::valid(slot, recordSize); }
+    static View view(const char * record, const char * slot) { return FieldCodec<T>::view(record, slot); }
+
+    static void assign(Cow<T> & field, const View & view)
+    {
+        T value;
+        FieldCodec<T>::assign(value, view);
+        field = std::move(value);
+    }
+};
+
+namespace details {
+
+template<class Model, class Member>
+using FieldOf = std::remove_const_t<std::remove_reference_t<decltype(std::declval<const Model &>().*std::declval<Member>())>>;
+
+// Signature of the field list of a model, encoded data is read only by a model with the same one
+template<class Model>
+uint64_t schemaOf()
+{
+    // FNV-1a over the signatures of the fields
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            hash ^= (value >> (i * 8)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    };
+    mvc::forEachField<Model>([&mix](size_t index, auto member) {
+        mix(index);
+        mix(FieldCodec<FieldOf<Model, decltype(member)>>::signature());
+    });
+    return hash;
+}
+
+template<class Model>
+size_t slotsSize(ChangeMask fields)
+{
+    size_t size = 0;
+    mvc::forEachField<Model>([&size, fields](size_t index, auto member) {
+        if (fields & (ChangeMask(1) << index))
+            size += FieldCodec<FieldOf<Model, decltype(member)>>::SlotSize;
+    });
+    return size;
+}
+
+} // namespace details
+
+//! Appends a record of the fields of the mask to the buffer. Returns false and appends
+//! nothing if the record doesn't fit into 4 GiB
+template<class Model>
+bool encode(std::vector<char> & buffer, const Model & model, ChangeMask fields = AllFields)
+{
+    static_assert(isReflected<Model>(), "Encoding needs the field list of the model");
+    details::RecordWriter out(buffer, details::slotsSize<Model>(fields));
+    forEachField<Model>([&out, &model, fields](size_t index, auto member) {
+        if (fields & (ChangeMask(1) << index))
+            FieldCodec<details::FieldOf<Model, decltype(member)>>::write(out, model.*member);
+    });
+    return out.finish();
+}
+
+//! Encoded model read in place. The buffer must outlive the view and views of its fields
+template<class Model>
+class RecordView
+{
+public:
+    RecordView() = default;
+
+    // The record at the start of the data, "fields" is the mask it was encoded with.
+    // The record is checked against the size of the data, a broken one isn't valid
+    RecordView(const char * data, size_t size, ChangeMask fields = AllFields)
+        : m_data(data)
+        , m_fields(fields)
+    {
+        uint32_t recordSize = 0;
+        if (size < details::RecordHeaderSize)
+            return;
+        std::memcpy(&recordSize, data, sizeof(recordSize));
+        if (recordSize > size || recordSize < details::RecordHeaderSize + details::slotsSize<Model>(fields))
+            return;
+
+        bool valid = true;
+        const char * slot = data + details::RecordHeaderSize;
+        forEachField<Model>([&valid, &slot, fields, recordSize](size_t index, auto member) {
+            using Codec = FieldCodec<details::FieldOf<Model, decltype(member)>>;
+            if (fields & (ChangeMask(1) << index)) {
+                valid = valid && Codec::valid(slot, recordSize);
+                slot += Codec::SlotSize;
+            }
+        });
+        if (valid)
+            m_size = recordSize;
+    }
+
+    bool valid() const { return m_size != 0; }
+    // Bytes of the record
+    size_t size() const { return m_size; }
+    ChangeMask fields() const { return m_fields; }
+
+    template<class T>
+    bool has(T Model::* member) const { return (fieldMask(member) & m_fields) != 0; }
+
+    // Value of a field of the record (StringRef for strings), the record must have the field
+    template<class T>
+    typename FieldCodec<std::remove_const_t<T>>::View get(T Model::* member) const
+    {
+        using Codec = FieldCodec<std::remove_const_t<T>>;
+        assert(valid() && has(member) && "The record doesn't have the field");
+        const char * slot = m_data + details::RecordHeaderSize;
+        bool found = false;
+        forEachField<Model>([&slot, &found, member, this](size_t index, auto field) {
+            if (found || !(m_fields & (ChangeMask(1) << index)))
+                return;
+            found = details::sameMember(field, member, std::is_same<decltype(field), decltype(member)>());
+            if (!found)
+                slot += FieldCodec<details::FieldOf<Model, decltype(field)>>::SlotSize;
+        });
+        return Codec::view(m_data, slot);
+    }
+
+    // Assigns fields of the record to the model, the others are left as they are
+    void decode(Model & model) const
+    {
+        assert(valid() && "The record is broken");
+        const char * slot = m_data + details::RecordHeaderSize;
+        forEachField<Model>([&slot, &model, this](size_t index, auto member) {
+            using Codec = FieldCodec<details::FieldOf<Model, decltype(member)>>;
+            if (m_fields & (ChangeMask(1) << index)) {
+                Codec::assign(model.*member, Codec::view(m_data, slot));
+                slot += Codec::SlotSize;
+            }
+        });
+    }
+
+private:
+    const char * m_data = nullptr;
+    size_t m_size = 0; // zero for a broken record
+    ChangeMask m_fields = AllFields;
+};
+
+enum class EventType : uint8_t { Create = 1, Update = 2, Remove = 3 };
+
+//! Appends a record of a creation (all fields of the model), an update (the changed
+//! fields) or a removal (no model) of the model with the key. Returns false and appends
+//! nothing if the model can't be encoded
+template<class Model>
+bool encodeEvent(std::vector<char> & buffer, EventType type, uint64_t key,
+                 const Model * model = nullptr, ChangeMask fields = AllFields)
+{
+    const size_t start = buffer.size();
+    const auto bytes = [&buffer](const void * data, size_t size) {
+        buffer.insert(buffer.end(), static_cast<const char *>(data), static_cast<const char *>(data) + size);
+    };
+    bytes(&type, sizeof(type));
+    bytes(&key, sizeof(key));
+    if (type == EventType::Update)
+        bytes(&fields, sizeof(fields));
+    if (type != EventType::Remove && !encode(buffer, *model, type == EventType::Create ? AllFields : fields)) {
+        buffer.resize(start);
+        return false;
+    }
+    return true;
+}
+
+//! Encoded event read in place
+template<class Model>
+class EventView
+{
+public:
+    EventView(const char * data, size_t size)
+    {
+        constexpr size_t head = sizeof(uint8_t) + sizeof(uint64_t);
+        if (size < head)
+            return;
+        std::memcpy(&m_type, data, sizeof(m_type));
+        std::memcpy(&m_key, data + sizeof(m_type), sizeof(m_key));
+        size_t used = head;
+        switch (m_type) {
+        case EventType::Update:
+            if (size < used + sizeof(m_fields))
+                return;
+            std::memcpy(&m_fields, data + used, sizeof(m_fields));
+            used += sizeof(m_fields);
+            // fall through
+        case EventType::Create:
+            m_model = RecordView<Model>(data + used, size - used, m_fields);
+            if (!m_model.valid())
+                return;
+            used += m_model.size();
+            break;
+        case EventType::Remove:
+            break;
+        default:
+            return;
+        }
+        m_size = used;
+    }
+
+    bool valid() const { return m_size != 0; }
+    // Bytes of the event
+    size_t size() const { return m_size; }
+    EventType type() const { return m_type; }
+    uint64_t key() const { return m_key; }
+    // Fields of a creation or an update
+    const RecordView<Model> & model() const { return m_model; }
+
+private:
+    EventType m_type = EventType::Remove;
+    uint64_t m_key = 0;
+    ChangeMask m_fields = AllFields;
+    RecordView<Model> m_model;
+    size_t m_size = 0; // zero for a broken event
+};
+
+} // namespace mvc
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <mutex>
+#include <cassert>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <shared_mutex>
+
+#include "controller.h"
+#include "details/mpsc_queue.h"
+
+
+namespace mvc {
+
+//! Controller which accepts create, update and remove requests from any thread.
+//! Requests go to a lock-free queue and are applied by one owner thread, the thread
+//! which calls "run" or "processPending". Callbacks of the controller and views are
+//! called on the owner thread in the order the requests were queued. Requests taken
+//! from the queue together are applied as one batch (one drain), so views get bulk
+//! callbacks and options like Option::CoalesceUpdates work across threads.
+//!
+//! Only requests are thread-safe. Views are attached, options are set and models are
+//! read on the owner thread (or before it starts), other threads get consistent
+//! copies of models through update requests. A memory resource given to the
+//! controller must be thread-safe.
+template<class Model>
+class ConcurrentController : public Controller<Model>
+{
+    using Base = Controller<Model>;
+    static_assert(!isLocalModel<Model>(), "Models of a concurrent controller must be shared between threads");
+public:
+    using typename Base::Event;
+    using typename Base::ModelPtr;
+    using typename Base::ModelPtrC;
+
+    using Base::Base;
+
+    // Requests by pointer are made on any thread, requests by id and "find" read the
+    // model set on the owner thread (or before it starts)
+    using Base::updateRequest;
+    using Base::removeRequest;
+    typename Base::ModelUpdater updateRequest(ModelId id);
+    typename Base::ModelRemover removeRequest(ModelId id);
+    ModelPtrC find(ModelId id) const;
+
+    // Applies requests on the calling thread until "stop" is called
+    void run();
+    // Makes "run" return after it applies all requests queued before
+    void stop();
+    // Applies all queued requests on the calling thread, returns the number of requests.
+    // They are applied in batches of at most MaxPassSize requests
+    size_t processPending();
+
+    enum : size_t { MaxPassSize = 4096 };
+
+protected:
+    void processEvent(Event event) override;
+    void drainEvents(bool batch) override;
+    ModelPtr makeDraft(const Model & model) override;
+
+private:
+    bool isOwnerThread() const { return m_owner.load() == std::this_thread::get_id(); }
+    bool mayReadModels() const { return m_owner.load() == std::thread::id() || isOwnerThread(); }
+    void wait();
+
+private:
+    details::MpscQueue<Event> m_queue;
+    std::atomic<std::thread::id> m_owner{std::thread::id()};
+
+    // models are changed in place (swap with a draft), copies on other threads must wait
+    std::shared_timed_mutex m_modelsMutex;
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_sleeping{false};
+    std::atomic<bool> m_stop{false};
+};
+
+template <class Model>
+void ConcurrentController<Model>::run()
+{
+    m_owner = std::this_thread::get_id();
+    for (;;) {
+        processPending();
+        if (m_stop.load()) {
+            processPending();
+            break;
+        }
+        wait();
+    }
+    m_stop = false;
+    m_owner = std::thread::id();
+}
+
+template <class Model>
+void ConcurrentController<Model>::stop()
+{
+    m_stop = true;
+    { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+    m_wake.notify_one();
+}
+
+template <class Model>
+size_t ConcurrentController<Model>::processPending()
+{
+    m_owner = std::this_thread::get_id();
+    size_t count = 0;
+    Event event;
+    for (;;) {
+        // one drain per pass, the limit lets views see requests of busy producers
+        size_t popped = 0;
+        {
+            auto pass = this->batch();
+            while (popped < MaxPassSize && m_queue.pop(event)) {
+                Base::processEvent(std::move(event));
+                ++popped;
+            }
+        }
+        count += popped;
+        if (popped < MaxPassSize)
+            return count;
+    }
+}
+
+template <class Model>
+void ConcurrentController<Model>::processEvent(Event event)
+{
+    if (!isOwnerThread()) {
+        m_queue.push(std::move(event));
+        if (m_sleeping.load()) {
+            { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+            m_wake.notify_one();
+        }
+    } else {
+        // a reentrant request joins the current cascade, a request in a batch waits for it
+        Base::processEvent(std::move(event));
+    }
+}
+
+template <class Model>
+void ConcurrentController<Model>::drainEvents(bool batch)
+{
+    {
+        // models are changed in place (swapped with drafts) while drafts are copied on other threads
+        std::unique_lock<std::shared_timed_mutex> lock(m_modelsMutex);
+        this->applyEvents(batch);
+    }
+    // the records are encoded already, other threads make drafts during the sync
+    this->commitJournal();
+}
+
+template <class Model>
+auto ConcurrentController<Model>::updateRequest(ModelId id) -> typename Base::ModelUpdater
+{
+    assert(mayReadModels() && "Ids are resolved on the owner thread");
+    return Base::updateRequest(id);
+}
+
+template <class Model>
+auto ConcurrentController<Model>::removeRequest(ModelId id) -> typename Base::ModelRemover
+{
+    assert(mayReadModels() && "Ids are resolved on the owner thread");
+    return Base::removeRequest(id);
+}
+
+template <class Model>
+auto ConcurrentController<Model>::find(ModelId id) const -> ModelPtrC
+{
+    assert(mayReadModels() && "Models are read on the owner thread");
+    return Base::find(id);
+}
+
+template <class Model>
+auto ConcurrentController<Model>::makeDraft(const Model & model) -> ModelPtr
+{
+    if (isOwnerThread())
+        return Base::makeDraft(model);
+
+    std::shared_lock<std::shared_timed_mutex> lock(m_modelsMutex);
+    return this->makeModel(model);
+}
+
+template <class Model>
+void ConcurrentController<Model>::wait()
+{
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    m_sleeping = true;
+    m_wake.wait(lock, [this] { return !m_queue.empty() || m_stop.load(); });
+    m_sleeping = false;
+}
+
+} // namespace mvc
@@ -2,42 +2,116 @@
 
 #include <cassert>
 
-#include <deque>
 #include <vector>
 #include <memory>
+#include <string>
+#include <cstdint>
 #include <algorithm>
 #include <functional>
-#include <unordered_set>
+#include <unordered_map>
 
+#include "index.h"
+#include "memory.h"
+#include "checkpoint.h"
+#include "journal.h"
+#include "model_ptr.h"
+#include "model_set.h"
+#include "snapshot.h"
 #include "details/observer.h"
+#include "details/ring_buffer.h"
 
 
 namespace mvc {
 
+//! Optional behaviour of a controller, flags are combined and passed to Controller::setOptions
+struct Option
+{
+    enum : unsigned
+    {
+        // Drafts of updates requested while events are processed (reentrant cascades)
+        // are allocated in an arena which is reset when the event queue is drained
+        CascadeArena = 1 << 0,
+        // Views receive one "updated" per model when the event queue is drained, with the
+        // state before the first update as "from", instead of every intermediate state.
+        // A batch passes one item per model to "updatedBatch"
+        CoalesceUpdates = 1 << 1,
+        // A removal cancels queued requests of the same model: a queued create together with
+        // the removal are dropped, queued updates are dropped. Dropped events don't call
+        // "aboutTo" callbacks and views aren't notified about them
+        FuseEvents = 1 << 2,
+        // An update whose draft equals the current state after "aboutToUpdate" is dropped: the
+        // model isn't changed, the journal doesn't record it and views aren't notified. States
+        // are compared by operator == if the model has one, otherwise by the field list, so
+        // changes of fields which aren't listed are dropped too
+        SuppressNoOpUpdates = 1 << 3,
+    };
+};
+
+template<class Model, class Shard>
+class ShardedController;
+
 //! General controller class
 template<class Model>
-class Controller
+class Controller : private details::ObserverRegistry<Model>
 {
-    using CtrlPtr = std::shared_ptr<Controller<Model>>;
+    // allocates models of the shards
+    template<class, class> friend class ShardedController;
 public:
-    Controller() : m_self(CtrlPtr(this, [](auto){}))
+    Controller() = default;
+    // Model objects and drafts are allocated from the resource instead of the global heap,
+    // the resource must outlive all model objects (views can keep them longer than the controller)
+    explicit Controller(MemoryResourcePtr resource)
+        : m_resource(std::move(resource))
     {}
     virtual ~Controller()
     {
         assert(m_models.empty() && "All model objects must be removed");
+        for (auto view : m_views) {
+            if (view != nullptr)
+                this->unsubscribe(view);
+        }
+        for (auto && predicate : m_predicateViews) {
+            if (predicate.view != nullptr)
+                this->unsubscribe(predicate.view);
+        }
+        // subscriptions to models which weren't removed
+        for (auto && item : m_modelViews) {
+            for (auto view : item.second) {
+                if (view != nullptr)
+                    this->unsubscribe(view);
+            }
+        }
     }
 
     // Aliases
-    using ModelPtr = std::shared_ptr<Model>;
-    using ModelPtrC = std::shared_ptr<const Model>;
+    using ModelPtr = typename details::ModelPtrTraits<Model>::Ptr;
+    using ModelPtrC = typename details::ModelPtrTraits<Model>::PtrC;
     using ViewPtr = std::shared_ptr<details::Observer<Model>>;
-    using Models = std::unordered_set<ModelPtrC>;
+    using Models = ModelSet<Model>;
 
-    // Attach and detach observers (views)
-    void attach(ViewPtr view);
+    // Attach and detach observers (views) in O(1). The controller doesn't own views,
+    // a destroyed view detaches itself
+    class Subscription;
+    Subscription attach(details::Observer<Model> & view);
+    Subscription attach(const ViewPtr & view) { return attach(*view); }
+    // Detaches all subscriptions of the view
+    void detach(details::Observer<Model> & view) { detach(&view); }
     void detach(const ViewPtr & view);
+    void detach(const Subscription & subscription);
 
-    // Provides copies of a model, accept changes, calls "aboutToUpdate" and "notifyUpdated"
+    // Scoped subscriptions, the view receives only events of one model or of models
+    // matching the predicate (updates match by the new or the previous state). Every
+    // subscription is notified on its own and with per-item callbacks in batches.
+    // A model subscription ends when the model is removed
+    using Predicate = std::function<bool(const Model &)>;
+    Subscription attach(details::Observer<Model> & view, const ModelPtrC & model);
+    Subscription attach(details::Observer<Model> & view, Predicate predicate);
+    // The view receives creations, removals and updates which change the fields,
+    // see mvc::fieldMask. Only predicate models (or none) can be filtered out by the mask
+    Subscription attach(details::Observer<Model> & view, ChangeMask fields, Predicate predicate = nullptr);
+
+    // Provides copies of a model, accept changes, calls "aboutToUpdate" and "notifyUpdated".
+    // Requests refer to the controller, they must not outlive it
     class ModelCreator;
     class ModelRemover;
     class ModelUpdater;
@@ -46,82 +120,698 @@ public:
     ModelCreator createRequest();
     ModelRemover removeRequest(ModelPtrC model);
     ModelUpdater updateRequest(ModelPtrC model);
+    // Requests for a model found by its id, the model must exist. Ids are resolved
+    // when the request is made, on the owner thread of a concurrent controller
+    ModelRemover removeRequest(ModelId id);
+    ModelUpdater updateRequest(ModelId id);
+
+    // Defers all requests until the returned object is destroyed, then applies them in one
+    // pass and notifies views with bulk callbacks. Works for the outermost batch only,
+    // requests made while events are being processed are queued as usual
+    class Batch;
+    Batch batch();
 
     const Models & models() const { return m_models; }
+    // Returns null if the model is removed (or not yet created). The model set is read,
+    // so a concurrent controller finds models on its owner thread only
+    ModelPtrC find(ModelId id) const { return m_models.find(id); }
+    // Returns an invalid id if the model isn't created yet or is removed
+    ModelId idOf(const ModelPtrC & model) const { return m_models.idOf(model); }
+
+    // Secondary indexes by a model field, e.g. "addIndex(&Page::url)". They are updated
+    // when events are applied, an update re-indexes the model only if the field is changed.
+    // An index lives as long as the controller
+    template<class Key, class Hash = std::hash<Key>>
+    const HashIndex<Model, Key, Hash> & addIndex(Key Model::* member);
+    template<class Key, class Compare = std::less<Key>>
+    const OrderedIndex<Model, Key, Compare> & addOrderedIndex(Key Model::* member);
+
+    // Writes all models to a file in the binary format of mvc/snapshot.h, the model needs
+    // a field list. Returns false if the file can't be written
+    bool saveSnapshot(const std::string & path) const;
+    // Creates the models of a snapshot in one batch, views receive one "createdBatch".
+    // Returns false and creates nothing if the file can't be read or has other fields
+    bool loadSnapshot(const std::string & path);
+
+    // Writes a snapshot of the models as they are now on a background thread while the
+    // controller goes on applying requests. A model is copied if it is updated before it is
+    // written, removed models are kept until the checkpoint ends. Returns false if another
+    // checkpoint is being written. A finished checkpoint releases its models at the end of
+    // the next drain or in "waitCheckpoint"
+    bool checkpoint(const std::string & path);
+    bool checkpointRunning() const { return m_checkpoint != nullptr && !m_checkpoint->finished(); }
+    // Waits for the current checkpoint, returns statistics of the last finished one
+    const CheckpointStats & waitCheckpoint();
+
+    // Appends every applied event to a journal file, the model needs a field list which covers
+    // its whole state, fields which aren't listed aren't recorded. An existing
+    // journal is replayed first, its models are created in their last states in one batch.
+    // "aboutTo" callbacks aren't called for them, their effects are in the journal already.
+    // Models of the controller which aren't in the journal are recorded as created. Records
+    // are written at the end of every drain (group commit) and synced by the options.
+    // Must be called outside of drains and batches. Returns false and creates nothing if the
+    // file can't be read or opened, was written for other fields or has a record which doesn't
+    // fit the replayed models, the records are left in the file then
+    bool openJournal(const std::string & path, JournalOptions options = JournalOptions());
+    // Writes and syncs buffered records, returns false if any write of the journal failed
+    bool flushJournal();
+    // Replaces the journal with creations of the current models, which also recovers
+    // a journal after a failed write
+    bool compactJournal();
+    void closeJournal() { m_journal.reset(); }
+    // Counters of the open journal, "ok" is reset by a failed write and records of later
+    // events are counted as dropped
+    JournalStats journalStats() const { return m_journal != nullptr ? m_journal->stats() : JournalStats(); }
+
+    // Combination of Option flags
+    void setOptions(unsigned options);
+    unsigned options() const { return m_options; }
+
+    // Number of updates dropped by Option::SuppressNoOpUpdates
+    size_t suppressedUpdates() const { return m_suppressedUpdates; }
 
 protected:
     virtual void aboutToCreate(const ModelPtr  & /*model*/) {}
     virtual void aboutToRemove(const ModelPtrC & /*model*/) {}
     virtual void aboutToUpdate(const ModelPtrC & /*model*/, const ModelPtr & /*to*/) {}
 
-    void processEvent(std::function<void()> fun);
+    // Queued model change, it is applied when all previous events are processed
+    struct Event
+    {
+        enum class Type { Create, Update, Remove, Dropped } type;
+        ModelPtrC model; // updated or removed model object
+        ModelPtr draft;  // created model object or new state of updated one
+        ChangeMask changes = AllFields; // fields changed by an applied update
+        bool replayed = false; // a state restored from the journal, "aboutTo" callbacks aren't called
+    };
+
+    // Queues the event and processes the queue unless it is already being processed
+    virtual void processEvent(Event event);
+    // Applies the queued events and notifies views, as a batch or one by one, then writes
+    // their journal records. Controllers which share models with other threads override it
+    // to guard "applyEvents", the journal is written (and synced) out of the guard
+    virtual void drainEvents(bool batch)
+    {
+        applyEvents(batch);
+        commitJournal();
+    }
+    void applyEvents(bool batch) { drain(batch); }
+    // Writes records of the last drain, syncs them by the journal options
+    void commitJournal()
+    {
+        if (m_journal != nullptr)
+            m_journal->commit(false);
+    }
+
+    template<class... Args>
+    ModelPtr makeModel(Args && ... args);
+    // Copy of a model for an update request
+    virtual ModelPtr makeDraft(const Model & model);
+
+    // Use it to notify views about model status, controllers with views known at
+    // compile time override it to add their own fan-out
+    using ModelsC = typename details::Observer<Model>::ModelsC;
+    using Updates = typename details::Observer<Model>::Updates;
+    virtual void notifyCreated(const ModelPtrC & model);
+    virtual void notifyRemoved(const ModelPtrC & model);
+    // "changes" are the fields which differ in the two states, see mvc::changedFields
+    virtual void notifyUpdated(const ModelPtrC & model, const ModelPtrC & from, ChangeMask changes);
+    virtual void notifyCreatedBatch(const ModelsC & models);
+    virtual void notifyRemovedBatch(const ModelsC & models);
+    virtual void notifyUpdatedBatch(const Updates & updates);
 
 private:
+    // Calls "aboutTo" callback and changes the model set
+    void apply(Event & event);
+    // Appends the applied event to the journal
+    void journal(const Event & event);
+    void notifyEvent(const Event & event);
+    void drain(bool batch);
+    void applyBatch();
+
+    // Drops queued events cancelled by the removal, returns true if the removal is dropped too
+    bool fuse(const Event & removal);
+
+    // Coalescing of updates, returns true if the event notification is postponed
+    bool deferNotification(Event & event);
+    void flushDeferred();
+
     void create(ModelPtrC model);
     void remove(ModelPtrC model);
     void update(ModelPtrC model, ModelPtr to);
 
-    // Use it to notify views about model status
-    void notifyCreated(const ModelPtrC & model);
-    void notifyRemoved(const ModelPtrC & model);
-    void notifyUpdated(const ModelPtrC & model, const ModelPtrC & to);
+    // Calls the callable for every attached view, "fun(details::Observer<Model> &)"
+    template<class Fun>
+    void notify(Fun && fun);
+    // Calls the callable for views with subscriptions matching the model
+    template<class Fun>
+    void notifyScoped(const ModelPtrC & model, const Model * from, ChangeMask changes, Fun && fun);
+
+    void forget(details::Observer<Model> * view) override { detach(view); }
+    void detach(details::Observer<Model> * view);
+    void detachView(details::Observer<Model> * view);
+    void detachModel(details::Observer<Model> * view, const Model * model, size_t generation);
+    void detachPredicate(details::Observer<Model> * view, size_t index, size_t generation);
+    void freePredicate(size_t index);
+    // Ends subscriptions to the removed model
+    void dropModelViews(const Model * model);
+    // Removes slots of detached views, when they make up half of the slots
+    void compactViews();
 
-    void notify(std::function<void(ViewPtr)> fun);
+    // Plain and model subscriptions are stamped with the number of subscriptions made
+    // before them, handles of ended ones don't match a later subscription of the same view
+    struct ViewSlot
+    {
+        size_t index; // in m_views
+        size_t generation;
+    };
+
+    struct ModelScope
+    {
+        const Model * model;
+        size_t generation;
+    };
+
+    // Subscriptions of a view to models and predicates
+    struct Scopes
+    {
+        std::vector<ModelScope> models;
+        std::vector<size_t> predicates; // index in m_predicateViews
+    };
+
+    struct PredicateSlot
+    {
+        details::Observer<Model> * view = nullptr; // null for a free slot
+        Predicate predicate;                        // null matches every model
+        ChangeMask fields = 0;
+        size_t generation = 0; // is incremented when the slot is freed, handles of it are stale
+    };
+
+    // Changes of a batch collected for bulk notifications
+    struct BatchLog
+    {
+        ModelsC created;
+        ModelsC removed;
+        Updates updated;
+    };
 
 private:
-    CtrlPtr m_self;
+    MemoryResourcePtr m_resource;
+    MonotonicArena::Ptr m_arena;
+    unsigned m_options = 0;
+    size_t m_suppressedUpdates = 0;
     bool m_lock = false;
-    std::deque<std::function<void()>> m_events;
-    std::vector<std::weak_ptr<details::Observer<Model>>> m_views;
+    size_t m_batchDepth = 0;
+    BatchLog m_batchLog;
+    Updates m_deferred, m_flushing;
+    std::unordered_map<const Model *, size_t> m_deferredIndex; // position in m_deferred
+    details::RingBuffer<Event> m_events;
+    // Queued creations and updates of every model for Option::FuseEvents, they are chained
+    // by sequence numbers of events and forgotten when the queue is drained
+    enum : uint64_t { NoEvent = UINT64_MAX };
+    uint64_t m_queued = 0; // number of events ever queued, the sequence number of the next one
+    uint64_t m_pendingBase = 0; // sequence number of the first event of m_previousPending
+    std::unordered_map<const Model *, uint64_t> m_lastPending;
+    std::vector<uint64_t> m_previousPending; // previous queued event of the same model
+    std::vector<details::Observer<Model> *> m_views; // null for a detached view
+    std::unordered_map<const details::Observer<Model> *, ViewSlot> m_viewSlots;
+    size_t m_subscriptions = 0; // number of plain and model subscriptions ever made
+    size_t m_deadViews = 0;
+    // subscribers of every model, null for a detached view
+    std::unordered_map<const Model *, std::vector<details::Observer<Model> *>> m_modelViews;
+    std::vector<const Model *> m_dirtyModelViews; // lists with detached views
+    std::vector<PredicateSlot> m_predicateViews;
+    std::vector<size_t> m_freePredicates;
+    ChangeMask m_predicateFields = 0; // fields of all predicate subscriptions
+    bool m_predicateFieldsDirty = false;
+    std::unordered_map<const details::Observer<Model> *, Scopes> m_scopes;
     Models m_models;
+    std::vector<std::unique_ptr<details::IndexBase<Model>>> m_indexes;
+    std::unique_ptr<details::Journal<Model>> m_journal;
+    CheckpointStats m_checkpointStats;
+    std::unique_ptr<details::Checkpoint<Model>> m_checkpoint; // is joined before models are freed
+};
+
+//! Handle of an attached view
+template <class Model>
+class Controller<Model>::Subscription
+{
+    friend class Controller<Model>;
+    static constexpr size_t NoPredicate = static_cast<size_t>(-1);
+
+    const details::Observer<Model> * m_view = nullptr;
+    const Model * m_model = nullptr;   // a model subscription
+    size_t m_predicate = NoPredicate; // a predicate subscription
+    size_t m_generation = 0;          // of the subscription or the predicate slot
+
+    explicit Subscription(const details::Observer<Model> * view,
+                          const Model * model = nullptr,
+                          size_t predicate = NoPredicate,
+                          size_t generation = 0)
+        : m_view(view)
+        , m_model(model)
+        , m_predicate(predicate)
+        , m_generation(generation)
+    {}
+public:
+    Subscription() = default;
 };
 
 template <class Model>
-void Controller<Model>::attach(ViewPtr view)
+auto Controller<Model>::attach(details::Observer<Model> & view) -> Subscription
+{
+    const auto generation = m_subscriptions++;
+    const bool added = m_viewSlots.emplace(&view, ViewSlot{m_views.size(), generation}).second;
+    assert(added && "Current view is already added");
+    (void)added;
+    m_views.push_back(&view);
+    this->subscribe(&view);
+    return Subscription(&view, nullptr, Subscription::NoPredicate, generation);
+}
+
+template <class Model>
+auto Controller<Model>::attach(details::Observer<Model> & view, const ModelPtrC & model) -> Subscription
 {
-    assert(m_views.end() == std::find_if(
-            m_views.begin(),
-            m_views.end(),
-            [v = view.get()](auto val) { return val.lock().get() == v; }
-        ) && "Current view is already added"
-    );
-    m_views.push_back(std::move(view));
+    assert(m_models.find(model) != m_models.end() && "Model object doens't exists");
+    auto & models = m_scopes[&view].models;
+    assert(std::find_if(models.begin(), models.end(),
+                        [&model](const ModelScope & item){ return item.model == model.get(); }) == models.end() &&
+           "Current view is already added");
+    const auto generation = m_subscriptions++;
+    models.push_back({model.get(), generation});
+    m_modelViews[model.get()].push_back(&view);
+    this->subscribe(&view);
+    return Subscription(&view, model.get(), Subscription::NoPredicate, generation);
+}
+
+template <class Model>
+auto Controller<Model>::attach(details::Observer<Model> & view, Predicate predicate) -> Subscription
+{
+    return attach(view, AllFields, std::move(predicate));
+}
+
+template <class Model>
+auto Controller<Model>::attach(details::Observer<Model> & view, ChangeMask fields, Predicate predicate)
+    -> Subscription
+{
+    size_t index = m_predicateViews.size();
+    if (m_freePredicates.empty()) {
+        m_predicateViews.emplace_back();
+    } else {
+        index = m_freePredicates.back();
+        m_freePredicates.pop_back();
+    }
+    auto & slot = m_predicateViews[index];
+    slot.view = &view;
+    slot.predicate = std::move(predicate);
+    slot.fields = fields;
+    m_predicateFields |= fields;
+    m_scopes[&view].predicates.push_back(index);
+    this->subscribe(&view);
+    return Subscription(&view, nullptr, index, slot.generation);
 }
 
 template <class Model>
 void Controller<Model>::detach(const ViewPtr & view)
 {
-    auto it = std::remove_if(
-        m_views.begin(),
-        m_views.end(),
-        [v = view.get()](auto value) { return value.lock().get() == v; }
-    );
-    assert(it != m_views.end() && "View isn't found");
-    m_views.erase(it, m_views.end());
+    detach(view.get());
+}
+
+template <class Model>
+void Controller<Model>::detach(const Subscription & subscription)
+{
+    auto view = const_cast<details::Observer<Model> *>(subscription.m_view);
+    if (subscription.m_model != nullptr) {
+        detachModel(view, subscription.m_model, subscription.m_generation);
+    } else if (subscription.m_predicate != Subscription::NoPredicate) {
+        detachPredicate(view, subscription.m_predicate, subscription.m_generation);
+    } else {
+        // the view may be detached already, or detached and attached again
+        auto it = m_viewSlots.find(view);
+        if (it != m_viewSlots.end() && it->second.generation == subscription.m_generation)
+            detachView(view);
+    }
+}
+
+template <class Model>
+void Controller<Model>::detach(details::Observer<Model> * view)
+{
+    if (m_viewSlots.find(view) != m_viewSlots.end())
+        detachView(view);
+
+    auto it = m_scopes.find(view);
+    if (it == m_scopes.end())
+        return;
+    auto scopes = std::move(it->second);
+    m_scopes.erase(it);
+    for (auto && scope : scopes.models) {
+        auto & views = m_modelViews[scope.model];
+        *std::find(views.begin(), views.end(), view) = nullptr;
+        m_dirtyModelViews.push_back(scope.model);
+        this->unsubscribe(view);
+    }
+    for (auto index : scopes.predicates) {
+        freePredicate(index);
+        this->unsubscribe(view);
+    }
+    if (!m_lock)
+        compactViews();
+}
+
+template <class Model>
+void Controller<Model>::detachModel(details::Observer<Model> * view, const Model * model, size_t generation)
+{
+    // the subscription may have ended with the removal of the model or with the view
+    auto it = m_scopes.find(view);
+    if (it == m_scopes.end())
+        return;
+    auto & models = it->second.models;
+    auto scope = std::find_if(models.begin(), models.end(),
+                              [model](const ModelScope & item){ return item.model == model; });
+    if (scope == models.end() || scope->generation != generation)
+        return;
+    models.erase(scope);
+    if (models.empty() && it->second.predicates.empty())
+        m_scopes.erase(it);
+
+    auto & views = m_modelViews[model];
+    *std::find(views.begin(), views.end(), view) = nullptr; // notifyScoped() can be iterating
+    m_dirtyModelViews.push_back(model);
+    this->unsubscribe(view);
+    if (!m_lock)
+        compactViews();
+}
+
+template <class Model>
+void Controller<Model>::detachPredicate(details::Observer<Model> * view, size_t index, size_t generation)
+{
+    // a handle used twice or after the view is detached refers to a freed or reused slot
+    if (index >= m_predicateViews.size() || m_predicateViews[index].view != view ||
+        m_predicateViews[index].generation != generation)
+        return;
+    auto it = m_scopes.find(view);
+    assert(it != m_scopes.end() && "View isn't found");
+    auto & predicates = it->second.predicates;
+    predicates.erase(std::find(predicates.begin(), predicates.end(), index));
+    if (predicates.empty() && it->second.models.empty())
+        m_scopes.erase(it);
+
+    freePredicate(index);
+    this->unsubscribe(view);
+}
+
+template <class Model>
+void Controller<Model>::freePredicate(size_t index)
+{
+    auto & slot = m_predicateViews[index];
+    slot.view = nullptr;
+    slot.predicate = nullptr;
+    slot.fields = 0;
+    ++slot.generation;
+    m_freePredicates.push_back(index);
+    m_predicateFieldsDirty = true;
+}
+
+template <class Model>
+void Controller<Model>::dropModelViews(const Model * model)
+{
+    auto it = m_modelViews.find(model);
+    if (it == m_modelViews.end())
+        return;
+    for (auto view : it->second) {
+        if (view == nullptr)
+            continue;
+        auto scopes = m_scopes.find(view);
+        auto & models = scopes->second.models;
+        models.erase(std::find_if(models.begin(), models.end(),
+                                  [model](const ModelScope & item){ return item.model == model; }));
+        if (models.empty() && scopes->second.predicates.empty())
+            m_scopes.erase(scopes);
+        this->unsubscribe(view);
+    }
+    m_modelViews.erase(it);
+}
+
+template <class Model>
+void Controller<Model>::detachView(details::Observer<Model> * view)
+{
+    auto it = m_viewSlots.find(view);
+    assert(it != m_viewSlots.end() && "View isn't found");
+    m_views[it->second.index] = nullptr; // notify() can be iterating, the slot is compacted later
+    m_viewSlots.erase(it);
+    this->unsubscribe(view);
+    ++m_deadViews;
+    if (!m_lock)
+        compactViews();
+}
+
+template <class Model>
+void Controller<Model>::compactViews()
+{
+    for (auto model : m_dirtyModelViews) {
+        auto it = m_modelViews.find(model);
+        if (it == m_modelViews.end())
+            continue;
+        auto & views = it->second;
+        views.erase(std::remove(views.begin(), views.end(), nullptr), views.end());
+        if (views.empty())
+            m_modelViews.erase(it);
+    }
+    m_dirtyModelViews.clear();
+
+    if (m_deadViews * 2 < m_views.size())
+        return;
+
+    size_t size = 0;
+    for (size_t i = 0; i < m_views.size(); ++i) {
+        if (m_views[i] == nullptr)
+            continue;
+        m_viewSlots[m_views[i]].index = size;
+        m_views[size++] = m_views[i];
+    }
+    m_views.resize(size);
+    m_deadViews = 0;
 }
 
 template <class Model>
 auto Controller<Model>::createRequest() -> ModelCreator
 {
-    return ModelCreator(m_self);
+    return ModelCreator(*this);
 }
 
 template <class Model>
 auto Controller<Model>::updateRequest(ModelPtrC model) -> ModelUpdater
 {
-    return ModelUpdater(m_self, std::move(model));
+    return ModelUpdater(*this, std::move(model));
 }
 
 template <class Model>
 auto Controller<Model>::removeRequest(ModelPtrC model) -> ModelRemover
 {
-    return ModelRemover(m_self, std::move(model));
+    return ModelRemover(*this, std::move(model));
+}
+
+template <class Model>
+auto Controller<Model>::updateRequest(ModelId id) -> ModelUpdater
+{
+    auto model = m_models.find(id);
+    assert(model != nullptr && "Model object doens't exists");
+    return ModelUpdater(*this, std::move(model));
+}
+
+template <class Model>
+auto Controller<Model>::removeRequest(ModelId id) -> ModelRemover
+{
+    auto model = m_models.find(id);
+    assert(model != nullptr && "Model object doens't exists");
+    return ModelRemover(*this, std::move(model));
+}
+
+template <class Model>
+auto Controller<Model>::batch() -> Batch
+{
+    return Batch(*this);
+}
+
+template <class Model>
+template <class... Args>
+auto Controller<Model>::makeModel(Args && ... args) -> ModelPtr
+{
+    using Traits = details::ModelPtrTraits<Model>;
+    if (m_resource == nullptr)
+        return Traits::make(std::forward<Args>(args)...);
+    return Traits::allocate(ResourceAllocator<Model>(m_resource.get()), std::forward<Args>(args)...);
+}
+
+template <class Model>
+auto Controller<Model>::makeDraft(const Model & model) -> ModelPtr
+{
+    if (m_lock && m_arena != nullptr)
+        return details::ModelPtrTraits<Model>::allocate(ResourceAllocator<Model>(m_arena.get()), model);
+    return makeModel(model);
+}
+
+template <class Model>
+template <class Key, class Hash>
+auto Controller<Model>::addIndex(Key Model::* member) -> const HashIndex<Model, Key, Hash> &
+{
+    auto index = std::make_unique<HashIndex<Model, Key, Hash>>(member);
+    for (auto && model : m_models)
+        index->insert(model);
+    auto & result = *index;
+    m_indexes.push_back(std::move(index));
+    return result;
+}
+
+template <class Model>
+template <class Key, class Compare>
+auto Controller<Model>::addOrderedIndex(Key Model::* member) -> const OrderedIndex<Model, Key, Compare> &
+{
+    auto index = std::make_unique<OrderedIndex<Model, Key, Compare>>(member);
+    for (auto && model : m_models)
+        index->insert(model);
+    auto & result = *index;
+    m_indexes.push_back(std::move(index));
+    return result;
+}
+
+template <class Model>
+bool Controller<Model>::saveSnapshot(const std::string & path) const
+{
+    return details::writeSnapshot<Model>(path, [this](auto && fun) {
+        for (auto && model : m_models)
+            fun(*model);
+    });
+}
+
+template <class Model>
+bool Controller<Model>::loadSnapshot(const std::string & path)
+{
+    std::vector<ModelPtr> models;
+    if (!details::readSnapshot<Model>(path, [this]{ return makeModel(); }, models))
+        return false;
+
+    // applied here even by controllers which queue events elsewhere
+    auto pass = batch();
+    for (auto && model : models)
+        Controller::processEvent({Event::Type::Create, nullptr, std::move(model)});
+    return true;
+}
+
+template <class Model>
+bool Controller<Model>::checkpoint(const std::string & path)
+{
+    if (m_checkpoint != nullptr) {
+        if (!m_checkpoint->finished())
+            return false;
+        waitCheckpoint();
+    }
+    m_checkpoint = std::make_unique<details::Checkpoint<Model>>(m_models, path);
+    return true;
+}
+
+template <class Model>
+const CheckpointStats & Controller<Model>::waitCheckpoint()
+{
+    if (m_checkpoint != nullptr) {
+        m_checkpointStats = m_checkpoint->wait();
+        m_checkpoint.reset();
+    }
+    return m_checkpointStats;
+}
+
+template <class Model>
+bool Controller<Model>::openJournal(const std::string & path, JournalOptions options)
+{
+    static_assert(isReflected<Model>(), "A journal needs the field list of the model");
+    assert(m_journal == nullptr && "The journal is already open");
+    assert(!m_lock && m_batchDepth == 0 && "Queued events would be journaled twice");
+    using Journal = details::Journal<Model>;
+
+    // Every model of a journal starts with a creation record, later records are folded into
+    // the created object, so the replay makes one creation per model which is left
+    std::unordered_map<uint64_t, size_t> replayed; // creation event of a key
+    std::vector<Event> events;
+    auto replay = [this, &replayed, &events](const EventView<Model> & record) {
+        auto it = replayed.find(record.key());
+        if ((record.type() == EventType::Create) == (it != replayed.end()))
+            return false;
+        switch (record.type()) {
+        case EventType::Create: {
+            auto model = makeModel();
+            record.model().decode(*model);
+            replayed.emplace(record.key(), events.size());
+            events.push_back({Event::Type::Create, nullptr, std::move(model)});
+            return true;
+        }
+        case EventType::Update:
+            record.model().decode(*events[it->second].draft);
+            return true;
+        case EventType::Remove:
+            events[it->second] = {Event::Type::Dropped, nullptr, nullptr};
+            replayed.erase(it);
+            return true;
+        }
+        return false;
+    };
+    if (!Journal::replay(path, replay))
+        return false;
+
+    auto journal = std::make_unique<Journal>(options);
+    if (!journal->open(path))
+        return false;
+    for (auto && item : replayed)
+        journal->assign(events[item.second].draft.get(), item.first);
+    {
+        // applied here even by controllers which queue events elsewhere
+        auto pass = batch();
+        for (auto && event : events) {
+            event.replayed = true;
+            if (event.type != Event::Type::Dropped)
+                Controller::processEvent(std::move(event));
+        }
+    }
+    // models which were there before the journal is opened
+    for (auto && model : m_models) {
+        if (!journal->knows(model.get()))
+            journal->created(*model);
+    }
+    m_journal = std::move(journal);
+    return m_journal->commit(true);
+}
+
+template <class Model>
+bool Controller<Model>::flushJournal()
+{
+    return m_journal != nullptr && m_journal->commit(true);
+}
+
+template <class Model>
+bool Controller<Model>::compactJournal()
+{
+    return m_journal != nullptr && m_journal->compact(m_models);
+}
+
+template <class Model>
+void Controller<Model>::setOptions(unsigned options)
+{
+    assert((!(options & Option::SuppressNoOpUpdates) || isComparable<Model>()) &&
+           "Model states can't be compared");
+    m_options = options;
+    if (m_options & Option::CascadeArena) {
+        if (m_arena == nullptr)
+            m_arena = MonotonicArena::create();
+    } else {
+        m_arena.reset();
+    }
 }
 
 template <class Model>
 void Controller<Model>::create(ModelPtrC model)
 {
     assert(m_models.find(model) == m_models.end() && "Model object already exists");
+    for (auto && index : m_indexes)
+        index->insert(model);
     m_models.insert(std::move(model));
 }
 
@@ -129,6 +819,8 @@ template <class Model>
 void Controller<Model>::remove(ModelPtrC model)
 {
     assert(m_models.find(model) != m_models.end() && "Model object doens't exists");
+    for (auto && index : m_indexes)
+        index->erase(model);
     m_models.erase(model);
 }
 
@@ -136,46 +828,235 @@ template <class Model>
 void Controller<Model>::update(ModelPtrC model, ModelPtr to)
 {
     assert(m_models.find(model) != m_models.end() && "Model object doens't exists");
+    for (auto && index : m_indexes)
+        index->update(model, *to);
+    // a running checkpoint may not have written the model yet
+    if (m_checkpoint != nullptr && m_checkpoint->claim(m_models.idOf(model), model.get()))
+        m_checkpoint->preserve(makeModel(*model));
     // unfortunately here we have to use const_cast
-    std::swap(*(std::const_pointer_cast<Model>(model)), *to);
+    std::swap(const_cast<Model &>(*model), *to);
 }
 
 template <class Model>
 void Controller<Model>::notifyCreated(const ModelPtrC & model)
 {
-    notify([model](auto &&view){ view->created(model); });
+    auto fun = [&model](auto && view){ view.created(model); };
+    notify(fun);
+    notifyScoped(model, nullptr, AllFields, fun);
 }
 
 template <class Model>
-void Controller<Model>::notifyUpdated(const ModelPtrC & model, const ModelPtrC & from)
+void Controller<Model>::notifyUpdated(const ModelPtrC & model, const ModelPtrC & from, ChangeMask changes)
 {
-    notify([model, from = std::move(from)](auto && view){ view->updated(model, from); });
+    auto fun = [&model, &from, changes](auto && view){ view.updated(model, from, changes); };
+    notify(fun);
+    notifyScoped(model, from.get(), changes, fun);
 }
 
 template <class Model>
 void Controller<Model>::notifyRemoved(const ModelPtrC & model)
 {
-    notify([model](auto && view){ view->removed(model); });
+    auto fun = [&model](auto && view){ view.removed(model); };
+    notify(fun);
+    notifyScoped(model, nullptr, AllFields, fun);
 }
 
 template <class Model>
-void Controller<Model>::notify(std::function<void(ViewPtr)> fun)
+void Controller<Model>::notifyCreatedBatch(const ModelsC & models)
 {
-    for (size_t i = 0; i < m_views.size();) {
-        if (auto v = m_views[i++].lock())
-            fun(v);
-        else
-            detach(v);
+    notify([&models](auto && view){ view.createdBatch(models); });
+    for (auto && model : models)
+        notifyScoped(model, nullptr, AllFields, [&model](auto && view){ view.created(model); });
+}
+
+template <class Model>
+void Controller<Model>::notifyRemovedBatch(const ModelsC & models)
+{
+    notify([&models](auto && view){ view.removedBatch(models); });
+    for (auto && model : models)
+        notifyScoped(model, nullptr, AllFields, [&model](auto && view){ view.removed(model); });
+}
+
+template <class Model>
+void Controller<Model>::notifyUpdatedBatch(const Updates & updates)
+{
+    notify([&updates](auto && view){ view.updatedBatch(updates); });
+    if (m_modelViews.empty() && m_predicateViews.empty())
+        return;
+    for (auto && update : updates) {
+        auto & model = update.model;
+        auto & from = update.from;
+        const auto changes = update.changes;
+        notifyScoped(model, from.get(), changes,
+                     [&model, &from, changes](auto && view){ view.updated(model, from, changes); });
     }
 }
 
 template <class Model>
-void Controller<Model>::processEvent(std::function<void()> event)
+template <class Fun>
+void Controller<Model>::notifyScoped(const ModelPtrC & model, const Model * from, ChangeMask changes, Fun && fun)
 {
-    m_events.push_back(event);
-    if (m_lock)
+    if (!m_modelViews.empty()) {
+        auto it = m_modelViews.find(model.get());
+        if (it != m_modelViews.end()) {
+            auto & views = it->second; // the list can grow while it is iterated
+            for (size_t i = 0; i < views.size(); ++i) {
+                if (auto view = views[i])
+                    fun(*view);
+            }
+        }
+    }
+    if (m_predicateFieldsDirty) {
+        m_predicateFields = 0;
+        for (auto && slot : m_predicateViews)
+            m_predicateFields |= slot.fields;
+        m_predicateFieldsDirty = false;
+    }
+    // creations and removals come with all bits
+    const bool everyField = changes == AllFields;
+    if (!everyField && !(m_predicateFields & changes))
         return;
+    for (size_t i = 0; i < m_predicateViews.size(); ++i) {
+        auto & slot = m_predicateViews[i];
+        if (slot.view == nullptr || (!everyField && !(slot.fields & changes)))
+            continue;
+        if (!slot.predicate || slot.predicate(*model) || (from != nullptr && slot.predicate(*from)))
+            fun(*m_predicateViews[i].view);
+    }
+}
+
+template <class Model>
+template <class Fun>
+void Controller<Model>::notify(Fun && fun)
+{
+    // views attached by callbacks are appended and get the current notification too,
+    // detached ones leave null in their slots until the drain ends
+    for (size_t i = 0; i < m_views.size(); ++i) {
+        if (auto view = m_views[i])
+            fun(*view);
+    }
+}
+
+template <class Model>
+void Controller<Model>::apply(Event & event)
+{
+    switch (event.type) {
+    case Event::Type::Create:
+        // effects of the callback were journaled with the model
+        if (!event.replayed)
+            aboutToCreate(event.draft);
+        create(event.draft);
+        break;
+    case Event::Type::Update:
+        if (event.draft == nullptr)
+            event.draft = makeDraft(*event.model);
+        aboutToUpdate(event.model, event.draft);
+        // once for views, scoped subscriptions and the journal
+        event.changes = changedFields(*event.draft, *event.model);
+        if ((m_options & Option::SuppressNoOpUpdates) &&
+            (details::IsEqualityComparable<Model>::value ? sameState(*event.draft, *event.model)
+                                                         : event.changes == 0)) {
+            ++m_suppressedUpdates;
+            event = {Event::Type::Dropped, nullptr, nullptr};
+            break;
+        }
+        update(event.model, event.draft); // swap data
+        break;
+    case Event::Type::Remove:
+        aboutToRemove(event.model);
+        remove(event.model);
+        break;
+    case Event::Type::Dropped:
+        break;
+    }
+    if (m_journal != nullptr)
+        journal(event);
+}
+
+template <class Model>
+void Controller<Model>::journal(const Event & event)
+{
+    switch (event.type) {
+    case Event::Type::Create:
+        m_journal->created(*event.draft);
+        break;
+    case Event::Type::Update:
+        // the draft has the previous state, operator == may see fields which aren't listed
+        assert((event.changes != 0 || sameState(*event.model, *event.draft) ||
+                !details::IsEqualityComparable<Model>::value) &&
+               "A journaled model changed fields which aren't in its field list");
+        m_journal->updated(*event.model, event.changes);
+        break;
+    case Event::Type::Remove:
+        m_journal->removed(*event.model);
+        break;
+    case Event::Type::Dropped:
+        break;
+    }
+}
+
+template <class Model>
+void Controller<Model>::notifyEvent(const Event & event)
+{
+    switch (event.type) {
+    case Event::Type::Create:
+        notifyCreated(event.draft);
+        break;
+    case Event::Type::Update:
+        notifyUpdated(event.model, event.draft, event.changes);
+        break;
+    case Event::Type::Remove:
+        notifyRemoved(event.model);
+        break;
+    case Event::Type::Dropped:
+        break;
+    }
+}
+
+template <class Model>
+void Controller<Model>::processEvent(Event event)
+{
+    if (m_options & Option::FuseEvents) {
+        if (event.type == Event::Type::Remove && fuse(event))
+            return;
+        if (event.type == Event::Type::Create || event.type == Event::Type::Update) {
+            const Model * model = event.type == Event::Type::Create ? event.draft.get() : event.model.get();
+            auto & last = m_lastPending.emplace(model, NoEvent).first->second;
+            // events queued while the option was off have no links
+            m_previousPending.resize(static_cast<size_t>(m_queued - m_pendingBase), NoEvent);
+            m_previousPending.push_back(last);
+            last = m_queued;
+        }
+    }
+
+    m_events.push_back(std::move(event));
+    ++m_queued;
+    if (!m_lock && m_batchDepth == 0)
+        drainEvents(false);
+}
+
+template <class Model>
+bool Controller<Model>::fuse(const Event & removal)
+{
+    auto it = m_lastPending.find(removal.model.get());
+    if (it == m_lastPending.end())
+        return false;
+    const uint64_t front = m_queued - m_events.size(); // sequence number of the front event
+    bool created = false;
+    // from the last event of the model back to the first one which is applied already
+    for (auto sequence = it->second; sequence != NoEvent && sequence >= front;
+         sequence = m_previousPending[static_cast<size_t>(sequence - m_pendingBase)]) {
+        auto & event = m_events[static_cast<size_t>(sequence - front)];
+        created = created || event.type == Event::Type::Create; // the model was never added
+        event = {Event::Type::Dropped, nullptr, nullptr};
+    }
+    m_lastPending.erase(it);
+    return created;
+}
 
+template <class Model>
+void Controller<Model>::drain(bool batch)
+{
     class BoolLock
     {
         bool & m_lock;
@@ -184,36 +1065,169 @@ void Controller<Model>::processEvent(std::function<void()> event)
         ~BoolLock() { m_lock = false; }
     } lock(m_lock);
 
+    if (batch)
+        applyBatch();
+
+    do {
+        while (!m_events.empty()) {
+            // the event is moved out, because the queue storage can grow while it is applied
+            auto event = m_events.take_front();
+            apply(event);
+            if (!deferNotification(event))
+                notifyEvent(event);
+            if (event.type == Event::Type::Remove)
+                dropModelViews(event.model.get());
+        }
+        flushDeferred(); // views can make new requests
+    } while (!m_events.empty());
+
+    if (m_arena != nullptr)
+        m_arena->release();
+    m_lastPending.clear();
+    m_previousPending.clear();
+    m_pendingBase = m_queued;
+    compactViews();
+    if (m_checkpoint != nullptr && m_checkpoint->finished())
+        waitCheckpoint();
+}
+
+template <class Model>
+bool Controller<Model>::deferNotification(Event & event)
+{
+    if (!(m_options & Option::CoalesceUpdates) ||
+        (event.type != Event::Type::Update && event.type != Event::Type::Remove))
+        return false;
+
+    auto it = m_deferredIndex.find(event.model.get());
+    if (event.type == Event::Type::Remove) {
+        // views have to see the last state before the model is removed
+        if (it != m_deferredIndex.end()) {
+            auto & update = m_deferred[it->second];
+            notifyUpdated(update.model, update.from, changedFields(*update.model, *update.from));
+            update.model = nullptr;
+            m_deferredIndex.erase(it);
+        }
+        return false;
+    }
+
+    // keep the first "from" state, intermediate drafts are dropped, changes from it are
+    // found when the views are notified
+    if (it == m_deferredIndex.end()) {
+        m_deferredIndex.emplace(event.model.get(), m_deferred.size());
+        m_deferred.push_back({std::move(event.model), std::move(event.draft), AllFields});
+    }
+    return true;
+}
+
+template <class Model>
+void Controller<Model>::flushDeferred()
+{
+    m_flushing.swap(m_deferred);
+    m_deferredIndex.clear();
+    for (auto && update : m_flushing) {
+        if (update.model != nullptr)
+            notifyUpdated(update.model, update.from, changedFields(*update.model, *update.from));
+    }
+    m_flushing.clear();
+}
+
+template <class Model>
+void Controller<Model>::applyBatch()
+{
+    size_t created = 0;
+    for (size_t i = 0; i < m_events.size(); ++i)
+        created += m_events[i].type == Event::Type::Create;
+    m_models.reserve(m_models.size() + created);
+
+    // requests made by "aboutTo" callbacks become a part of the batch
+    auto & log = m_batchLog;
+    const bool coalesce = (m_options & Option::CoalesceUpdates) != 0;
     while (!m_events.empty()) {
-        m_events.front()(); // execute event
-        m_events.pop_front();
+        auto event = m_events.take_front();
+        apply(event);
+        switch (event.type) {
+        case Event::Type::Create:
+            log.created.push_back(std::move(event.draft));
+            break;
+        case Event::Type::Update:
+            if (coalesce) {
+                // the first update keeps its "from", changes are found again when it is notified
+                auto it = m_deferredIndex.emplace(event.model.get(), log.updated.size());
+                if (!it.second) {
+                    log.updated[it.first->second].changes = AllFields;
+                    break;
+                }
+            }
+            log.updated.push_back({std::move(event.model), std::move(event.draft), event.changes});
+            break;
+        case Event::Type::Remove:
+            log.removed.push_back(std::move(event.model));
+            break;
+        case Event::Type::Dropped:
+            break;
+        }
+    }
+
+    if (coalesce) {
+        m_deferredIndex.clear();
+        for (auto && update : log.updated) {
+            if (update.changes == AllFields)
+                update.changes = changedFields(*update.model, *update.from);
+        }
     }
+
+    if (!log.created.empty())
+        notifyCreatedBatch(log.created);
+    if (!log.updated.empty())
+        notifyUpdatedBatch(log.updated);
+    if (!log.removed.empty())
+        notifyRemovedBatch(log.removed);
+    for (auto && model : log.removed)
+        dropModelViews(model.get());
+
+    log.created.clear();
+    log.updated.clear();
+    log.removed.clear();
 }
 
 template <class Model>
 class Controller<Model>::ModelCreator
 {
-    std::shared_ptr<Controller<Model>> m_ctrl;
+    Controller<Model> * m_ctrl; // null for a moved-from request
     ModelPtr m_model;
 public:
     ModelCreator(const ModelCreator &) = delete;
-    ModelCreator(ModelCreator &&) = default;
+    ModelCreator(ModelCreator && other)
+        : m_ctrl(other.m_ctrl)
+        , m_model(std::move(other.m_model))
+    {
+        other.m_ctrl = nullptr;
+    }
 
     ModelCreator& operator =(const ModelCreator &) = delete;
-    ModelCreator& operator =(ModelCreator &&) = default;
+    // The requests are exchanged, the previous one is applied with the other object
+    ModelCreator& operator =(ModelCreator && other)
+    {
+        std::swap(m_ctrl, other.m_ctrl);
+        std::swap(m_model, other.m_model);
+        return *this;
+    }
 
-    ModelCreator(std::shared_ptr<Controller<Model>> ctrl)
-        : m_ctrl(std::move(ctrl))
-        , m_model(std::make_shared<Model>())
+    ModelCreator(Controller<Model> & ctrl)
+        : m_ctrl(&ctrl)
+        , m_model(ctrl.makeModel())
+    {}
+
+    // Creation of an already allocated model object
+    ModelCreator(Controller<Model> & ctrl, ModelPtr model)
+        : m_ctrl(&ctrl)
+        , m_model(std::move(model))
     {}
 
     ~ModelCreator()
     {
-        m_ctrl->processEvent([ctrl = m_ctrl, model = std::move(m_model)] {
-            ctrl->aboutToCreate(model);
-            ctrl->create(model);
-            ctrl->notifyCreated(model);
-        });
+        if (m_ctrl != nullptr)
+            m_ctrl->processEvent({Event::Type::Create, nullptr, std::move(m_model)});
     }
 
     ModelPtr operator->()
@@ -235,45 +1249,62 @@ public:
 template <class Model>
 class Controller<Model>::ModelUpdater
 {
-    std::shared_ptr<Controller<Model>> m_ctrl;
+    Controller<Model> * m_ctrl; // null for a moved-from request
     ModelPtrC m_model;
     ModelPtr m_to;
 public:
     ModelUpdater(const ModelUpdater &) = delete;
-    ModelUpdater(ModelUpdater &&) = default;
+    ModelUpdater(ModelUpdater && other)
+        : m_ctrl(other.m_ctrl)
+        , m_model(std::move(other.m_model))
+        , m_to(std::move(other.m_to))
+    {
+        other.m_ctrl = nullptr;
+    }
 
     ModelUpdater& operator =(const ModelUpdater &) = delete;
-    ModelUpdater& operator =(ModelUpdater &&) = default;
+    // The requests are exchanged, the previous one is applied with the other object
+    ModelUpdater& operator =(ModelUpdater && other)
+    {
+        std::swap(m_ctrl, other.m_ctrl);
+        std::swap(m_model, other.m_model);
+        std::swap(m_to, other.m_to);
+        return *this;
+    }
 
-    ModelUpdater(
-        std::shared_ptr<Controller<Model>> ctrl,
-        ModelPtrC model)
-        : m_ctrl(std::move(ctrl))
+    // The model is copied into a draft on first access, an untouched
+    // request is copied when it is applied
+    ModelUpdater(Controller<Model> & ctrl, ModelPtrC model)
+        : m_ctrl(&ctrl)
         , m_model(std::move(model))
-        , m_to(std::make_shared<Model>(*m_model))
     {}
 
     ~ModelUpdater()
     {
-        m_ctrl->processEvent([ctrl = m_ctrl, model = std::move(m_model), to = std::move(m_to)] {
-            ctrl->aboutToUpdate(model, to);
-            ctrl->update(model, to); // swap data
-            ctrl->notifyUpdated(model, to);
-        });
+        if (m_ctrl != nullptr)
+            m_ctrl->processEvent({Event::Type::Update, std::move(m_model), std::move(m_to)});
     }
 
     ModelPtr operator->()
     {
-        return m_to;
+        return draft();
     }
 
     operator ModelPtr()
     {
-        return m_to;
+        return draft();
     }
 
     ModelPtr toPtr()
     {
+        return draft();
+    }
+
+private:
+    const ModelPtr & draft()
+    {
+        if (m_to == nullptr)
+            m_to = m_ctrl->makeDraft(*m_model);
         return m_to;
     }
 };
@@ -281,27 +1312,35 @@ public:
 template <class Model>
 class Controller<Model>::ModelRemover
 {
-    std::shared_ptr<Controller<Model>> m_ctrl;
+    Controller<Model> * m_ctrl; // null for a moved-from request
     ModelPtrC m_model;
 public:
     ModelRemover(const ModelRemover &) = delete;
-    ModelRemover(ModelRemover &&) = default;
+    ModelRemover(ModelRemover && other)
+        : m_ctrl(other.m_ctrl)
+        , m_model(std::move(other.m_model))
+    {
+        other.m_ctrl = nullptr;
+    }
 
     ModelRemover& operator =(const ModelRemover &) = delete;
-    ModelRemover& operator =(ModelRemover &&) = default;
+    // The requests are exchanged, the previous one is applied with the other object
+    ModelRemover& operator =(ModelRemover && other)
+    {
+        std::swap(m_ctrl, other.m_ctrl);
+        std::swap(m_model, other.m_model);
+        return *this;
+    }
 
-    ModelRemover(std::shared_ptr<Controller<Model>> ctrl, ModelPtrC model)
-        : m_ctrl(std::move(ctrl))
+    ModelRemover(Controller<Model> & ctrl, ModelPtrC model)
+        : m_ctrl(&ctrl)
         , m_model(std::move(model))
     {}
 
     ~ModelRemover()
     {
-        m_ctrl->processEvent([ctrl = m_ctrl, model = std::move(m_model)] {
-            ctrl->aboutToRemove(model);
-            ctrl->remove(model);
-            ctrl->notifyRemoved(model);
-        });
+        if (m_ctrl != nullptr)
+            m_ctrl->processEvent({Event::Type::Remove, std::move(m_model), nullptr});
     }
 
     ModelPtrC operator->()
@@ -320,4 +1359,29 @@ public:
     }
 };
 
+template <class Model>
+class Controller<Model>::Batch
+{
+    Controller<Model> * m_ctrl;
+public:
+    Batch(const Batch &) = delete;
+    Batch& operator =(const Batch &) = delete;
+
+    Batch(Batch && other) : m_ctrl(other.m_ctrl) { other.m_ctrl = nullptr; }
+
+    Batch(Controller<Model> & ctrl)
+        : m_ctrl(&ctrl)
+    {
+        ++m_ctrl->m_batchDepth;
+    }
+
+    ~Batch()
+    {
+        if (m_ctrl == nullptr || --m_ctrl->m_batchDepth > 0)
+            return;
+        if (!m_ctrl->m_lock && !m_ctrl->m_events.empty())
+            m_ctrl->drainEvents(true);
+    }
+};
+
 } // namespace mvc
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <type_traits>
+
+
+namespace mvc {
+
+//! Copy-on-write model field. Copies of a model (drafts, "from" states) share the
+//! value of the field until one of them assigns or edits it, so large fields cost
+//! a reference count instead of a deep copy when other fields are changed.
+template<class T>
+class Cow
+{
+    // null for default constructed value, the value is mutable for edit() but shared ones
+    // are only read
+    std::shared_ptr<T> m_value;
+
+public:
+    Cow() = default;
+    Cow(const T & value) : m_value(std::make_shared<T>(value)) {}
+    Cow(T && value) : m_value(std::make_shared<T>(std::move(value))) {}
+
+    template<class U, class = std::enable_if_t<
+        !std::is_same<std::decay_t<U>, Cow>::value &&
+        std::is_constructible<T, U &&>::value>>
+    Cow & operator =(U && value)
+    {
+        m_value = std::make_shared<T>(std::forward<U>(value));
+        return *this;
+    }
+
+    const T & get() const { return m_value ? *m_value : empty(); }
+    const T & operator *() const { return get(); }
+    const T * operator ->() const { return &get(); }
+    operator const T &() const { return get(); }
+
+    // Mutable access, makes an own copy of a shared value
+    T & edit()
+    {
+        if (!m_value || m_value.use_count() > 1)
+            m_value = std::make_shared<T>(get());
+        return *m_value;
+    }
+
+    // True when both fields refer to the same copy of the value
+    bool shares(const Cow & other) const { return m_value == other.m_value; }
+
+    friend bool operator ==(const Cow & l, const Cow & r) { return l.shares(r) || l.get() == r.get(); }
+    friend bool operator !=(const Cow & l, const Cow & r) { return !(l == r); }
+
+private:
+    static const T & empty()
+    {
+        static const T value{};
+        return value;
+    }
+};
+
+} // namespace mvc
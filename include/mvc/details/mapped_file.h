@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cerrno>
+#include <string>
+#include <cstddef>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define MVC_HAS_MMAP 1
+#else
+#include <vector>
+#include <fstream>
+#endif
+
+
+namespace mvc {
+namespace details {
+
+// Read-only view of a whole file, it is mapped into memory where mmap is available
+// and read into a buffer elsewhere. An empty or unreadable file gives an invalid view,
+// "missing" and "empty" tell these cases from a file which can't be read
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string & path) { open(path); }
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator =(const MappedFile &) = delete;
+
+    bool valid() const { return m_data != nullptr; }
+    // The file doesn't exist
+    bool missing() const { return m_missing; }
+    // The file exists and has no data
+    bool empty() const { return m_empty; }
+    const char * data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+#ifdef MVC_HAS_MMAP
+    void open(const std::string & path)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            m_missing = errno == ENOENT;
+            return;
+        }
+        struct stat info;
+        const bool stated = ::fstat(fd, &info) == 0;
+        m_empty = stated && info.st_size == 0;
+        if (stated && info.st_size > 0) {
+            const auto size = static_cast<size_t>(info.st_size);
+            void * data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                // models are decoded front to back once
+                ::madvise(data, size, MADV_SEQUENTIAL);
+                m_data = static_cast<const char *>(data);
+                m_size = size;
+            }
+        }
+        ::close(fd); // the mapping keeps the file
+    }
+
+    void close()
+    {
+        if (m_data != nullptr)
+            ::munmap(const_cast<char *>(m_data), m_size);
+    }
+#else
+    void open(const std::string & path)
+    {
+        errno = 0;
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            m_missing = errno == ENOENT;
+            return;
+        }
+        m_buffer.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        m_empty = m_buffer.empty();
+        if (m_empty || !file.read(m_buffer.data(), m_buffer.size()))
+            return;
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+    }
+
+    void close() {}
+
+    std::vector<char> m_buffer;
+#endif
+
+private:
+    const char * m_data = nullptr;
+    size_t m_size = 0;
+    bool m_missing = false;
+    bool m_empty = false;
+};
+
+} // namespace details
+} // namespace mvc
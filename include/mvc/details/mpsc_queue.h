@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+
+namespace mvc {
+namespace details {
+
+//! Lock-free intrusive multi-producer single-consumer queue (D. Vyukov's algorithm).
+//! "push" can be called from any thread, "pop" and "empty" only from the consumer thread.
+template<class T>
+class MpscQueue
+{
+    struct Node
+    {
+        std::atomic<Node *> next{nullptr};
+        T value;
+    };
+
+    std::atomic<Node *> m_head; // last pushed node
+    Node * m_tail;              // consumed node, its successor is the queue front
+
+public:
+    MpscQueue() : m_head(new Node), m_tail(m_head.load()) {}
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue & operator =(const MpscQueue &) = delete;
+
+    ~MpscQueue()
+    {
+        while (m_tail != nullptr) {
+            auto next = m_tail->next.load();
+            delete m_tail;
+            m_tail = next;
+        }
+    }
+
+    void push(T value)
+    {
+        auto node = new Node;
+        node->value = std::move(value);
+        auto prev = m_head.exchange(node, std::memory_order_acq_rel);
+        // the consumer can see an empty queue until this store, so it is sequentially
+        // consistent to be ordered with the consumer's "going to sleep" flag
+        prev->next.store(node, std::memory_order_seq_cst);
+    }
+
+    bool pop(T & value)
+    {
+        auto next = m_tail->next.load(std::memory_order_acquire);
+        if (next == nullptr)
+            return false;
+        value = std::move(next->value);
+        next->value = T();
+        delete m_tail;
+        m_tail = next;
+        return true;
+    }
+
+    bool empty() const
+    {
+        return m_tail->next.load(std::memory_order_seq_cst) == nullptr;
+    }
+};
+
+} // namespace details
+} // namespace mvc
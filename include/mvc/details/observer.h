@@ -1,21 +1,102 @@
 #pragma once
 
 #include <memory>
+#include <vector>
+#include <utility>
+
+#include "../model_ptr.h"
+#include "../reflection.h"
 
 
 namespace mvc {
 namespace details {
 
+template<class Model>
+struct Observer;
+
+//! Something observers are attached to (a controller). Every attached observer keeps
+//! a subscription token, the registry pointer, and uses it to detach itself on destruction.
+template<class Model>
+struct ObserverRegistry
+{
+    // Is called by an observer which is being destroyed
+    virtual void forget(Observer<Model> * observer) = 0;
+
+protected:
+    ~ObserverRegistry() = default;
+
+    void subscribe(Observer<Model> * observer)
+    {
+        observer->m_registries.push_back(this);
+    }
+
+    void unsubscribe(Observer<Model> * observer)
+    {
+        auto & registries = observer->m_registries;
+        for (size_t i = 0; i < registries.size(); ++i) {
+            if (registries[i] == this) {
+                registries[i] = registries.back();
+                registries.pop_back();
+                return;
+            }
+        }
+    }
+};
+
 template<class Model>
 struct Observer
 {
-    virtual ~Observer() = default;
+    Observer() = default;
+    // subscriptions belong to the observer object, they aren't copied
+    Observer(const Observer &) {}
+    Observer & operator =(const Observer &) { return *this; }
 
-    using ModelPtrC = std::shared_ptr<const Model>;
+    virtual ~Observer()
+    {
+        while (!m_registries.empty())
+            m_registries.back()->forget(this);
+    }
+
+    using ModelPtrC = typename ModelPtrTraits<Model>::PtrC;
     virtual void created(const ModelPtrC & /*model*/) {}
     virtual void removed(const ModelPtrC & /*model*/) {}
     virtual void updated(const ModelPtrC & /*model*/,
                          const ModelPtrC & /*from */) {}
+    // Is called by the controller, "changes" has bits of the fields which differ in the two
+    // states (all bits for a model without a field list), by default calls "updated" above
+    virtual void updated(const ModelPtrC & model, const ModelPtrC & from, ChangeMask /*changes*/)
+    {
+        updated(model, from);
+    }
+
+    // Bulk notifications of a batch, by default every item is passed to the callbacks above
+    using ModelsC = std::vector<ModelPtrC>;
+    struct Update
+    {
+        ModelPtrC model;
+        ModelPtrC from;
+        ChangeMask changes; // as in "updated" above
+    };
+    using Updates = std::vector<Update>;
+    virtual void createdBatch(const ModelsC & models)
+    {
+        for (auto && model : models)
+            created(model);
+    }
+    virtual void removedBatch(const ModelsC & models)
+    {
+        for (auto && model : models)
+            removed(model);
+    }
+    virtual void updatedBatch(const Updates & updates)
+    {
+        for (auto && update : updates)
+            updated(update.model, update.from, update.changes);
+    }
+
+private:
+    friend struct ObserverRegistry<Model>;
+    std::vector<ObserverRegistry<Model> *> m_registries; // subscription tokens
 };
 
 } // namespace details
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+
+namespace mvc {
+namespace details {
+
+//! FIFO queue over a circular buffer. The storage only grows, so a drained queue
+//! accepts new items without allocations.
+template<class T>
+class RingBuffer
+{
+    std::vector<T> m_items; // size is zero or power of two
+    size_t m_head = 0;
+    size_t m_size = 0;
+
+public:
+    bool empty() const { return m_size == 0; }
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_items.size(); }
+
+    T & front() { return m_items[m_head]; }
+
+    // Access by position from the front of the queue
+    T & operator[](size_t index) { return m_items[(m_head + index) & (m_items.size() - 1)]; }
+
+    void push_back(T item)
+    {
+        if (m_size == m_items.size())
+            grow();
+        (*this)[m_size++] = std::move(item);
+    }
+
+    // Moves the front item out of the queue
+    T take_front()
+    {
+        T item = std::move(m_items[m_head]);
+        m_items[m_head] = T();
+        m_head = (m_head + 1) & (m_items.size() - 1);
+        --m_size;
+        return item;
+    }
+
+private:
+    void grow()
+    {
+        std::vector<T> items(m_items.empty() ? 16 : m_items.size() * 2);
+        for (size_t i = 0; i < m_size; ++i)
+            items[i] = std::move((*this)[i]);
+        m_items.swap(items);
+        m_head = 0;
+    }
+};
+
+} // namespace details
+} // namespace mvc
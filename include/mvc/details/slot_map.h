@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <utility>
+
+
+namespace mvc {
+namespace details {
+
+//! Handle of a slot map item. The generation tells apart items which reused the slot
+//! of an erased one, a stale handle finds nothing.
+struct SlotId
+{
+    static constexpr uint32_t Invalid = UINT32_MAX;
+
+    uint32_t index = Invalid;
+    uint32_t generation = 0;
+
+    bool valid() const { return index != Invalid; }
+    bool operator ==(const SlotId & other) const
+    {
+        return index == other.index && generation == other.generation;
+    }
+    bool operator !=(const SlotId & other) const { return !(*this == other); }
+};
+
+//! Generational slot map. Items are kept densely packed in insertion order, erasing one
+//! moves the last item into its place. Lookups by handle go through one indirection.
+template<class T>
+class SlotMap
+{
+    struct Slot
+    {
+        uint32_t position;   // index in m_items, or the next free slot
+        uint32_t generation;
+    };
+
+    std::vector<T> m_items;
+    std::vector<uint32_t> m_owners; // slot of each item
+    std::vector<Slot> m_slots;
+    uint32_t m_free = SlotId::Invalid; // head of the free slot list
+
+public:
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    const_iterator begin() const { return m_items.begin(); }
+    const_iterator end() const { return m_items.end(); }
+    size_t size() const { return m_items.size(); }
+    bool empty() const { return m_items.empty(); }
+
+    void reserve(size_t size)
+    {
+        m_items.reserve(size);
+        m_owners.reserve(size);
+        m_slots.reserve(size);
+    }
+
+    SlotId insert(T item)
+    {
+        uint32_t index = m_free;
+        if (index == SlotId::Invalid) {
+            index = static_cast<uint32_t>(m_slots.size());
+            m_slots.push_back({0, 0});
+        } else {
+            m_free = m_slots[index].position;
+        }
+        m_slots[index].position = static_cast<uint32_t>(m_items.size());
+        m_items.push_back(std::move(item));
+        m_owners.push_back(index);
+        return {index, m_slots[index].generation};
+    }
+
+    // Returns null for a stale handle
+    const T * find(SlotId id) const
+    {
+        if (id.index >= m_slots.size() || m_slots[id.index].generation != id.generation)
+            return nullptr;
+        return &m_items[m_slots[id.index].position];
+    }
+
+    // Handle of the item at the position of the dense array
+    SlotId idAt(size_t position) const
+    {
+        const uint32_t index = m_owners[position];
+        return {index, m_slots[index].generation};
+    }
+
+    // The handle must be valid
+    const_iterator iteratorOf(SlotId id) const
+    {
+        assert(find(id) != nullptr && "Slot map item doesn't exist");
+        return begin() + m_slots[id.index].position;
+    }
+
+    void erase(SlotId id)
+    {
+        assert(find(id) != nullptr && "Slot map item doesn't exist");
+        auto & slot = m_slots[id.index];
+        const uint32_t position = slot.position;
+        if (position + 1 != m_items.size()) {
+            m_items[position] = std::move(m_items.back());
+            m_owners[position] = m_owners.back();
+            m_slots[m_owners[position]].position = position;
+        }
+        m_items.pop_back();
+        m_owners.pop_back();
+
+        ++slot.generation;
+        slot.position = m_free;
+        m_free = id.index;
+    }
+};
+
+} // namespace details
+} // namespace mvc
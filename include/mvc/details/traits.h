@@ -0,0 +1,12 @@
+#pragma once
+
+
+namespace mvc {
+namespace details {
+
+// std::void_t of C++17
+template<class...>
+using VoidT = void;
+
+} // namespace details
+} // namespace mvc
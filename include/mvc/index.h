@@ -0,0 +1,134 @@
+#pragma once
+
+#include <map>
+#include <utility>
+#include <functional>
+#include <unordered_map>
+
+#include "model_ptr.h"
+
+
+namespace mvc {
+namespace details {
+
+//! Secondary index of a controller, it is updated while events are applied
+template<class Model>
+struct IndexBase
+{
+    using ModelPtrC = typename ModelPtrTraits<Model>::PtrC;
+
+    virtual ~IndexBase() = default;
+
+    virtual void insert(const ModelPtrC & model) = 0;
+    virtual void erase(const ModelPtrC & model) = 0;
+    // Is called before the model takes the state of the draft
+    virtual void update(const ModelPtrC & model, const Model & to) = 0;
+};
+
+// Iterators of a hash map are invalidated when it rehashes, which changes the bucket count
+template<class... Args>
+size_t bucketCount(const std::unordered_multimap<Args...> & map) { return map.bucket_count(); }
+template<class... Args>
+size_t bucketCount(const std::multimap<Args...> &) { return 0; }
+
+// Common part of hash and ordered indexes over std::unordered_multimap or std::multimap.
+// The entry of every model is kept, so it is erased without a search among equal keys
+template<class Model, class Key, class Map>
+class MapIndex : public IndexBase<Model>
+{
+public:
+    using ModelPtrC = typename IndexBase<Model>::ModelPtrC;
+    using const_iterator = typename Map::const_iterator;
+    using Range = std::pair<const_iterator, const_iterator>;
+
+    explicit MapIndex(Key Model::* member) : m_member(member) {}
+
+    // Returns one of the models with the key, null if there is none
+    ModelPtrC find(const Key & key) const
+    {
+        auto it = m_map.find(key);
+        return it == m_map.end() ? nullptr : it->second;
+    }
+    // All models with the key, items are pairs of the key and the model
+    Range equal_range(const Key & key) const { return m_map.equal_range(key); }
+    size_t count(const Key & key) const { return m_map.count(key); }
+    size_t size() const { return m_map.size(); }
+
+    void insert(const ModelPtrC & model) override
+    {
+        insertEntry((*model).*m_member, model);
+    }
+
+    void erase(const ModelPtrC & model) override
+    {
+        auto it = m_entries.find(model.get());
+        m_map.erase(it->second);
+        m_entries.erase(it);
+    }
+
+    void update(const ModelPtrC & model, const Model & to) override
+    {
+        const Key & key = to.*m_member;
+        if ((*model).*m_member == key)
+            return;
+        auto & entry = m_entries.at(model.get());
+        m_map.erase(entry);
+        insertEntry(key, model);
+    }
+
+protected:
+    Map m_map;
+
+private:
+    void insertEntry(const Key & key, const ModelPtrC & model)
+    {
+        const size_t buckets = bucketCount(m_map);
+        auto it = m_map.emplace(key, model);
+        if (bucketCount(m_map) == buckets) {
+            m_entries[model.get()] = it;
+            return;
+        }
+        // rehashed, which is as rare as reallocations of a growing vector
+        for (auto entry = m_map.begin(); entry != m_map.end(); ++entry)
+            m_entries[entry->second.get()] = entry;
+    }
+
+private:
+    Key Model::* m_member;
+    std::unordered_map<const Model *, typename Map::iterator> m_entries;
+};
+
+} // namespace details
+
+//! Index of models by a field with O(1) lookups, keys needn't be unique
+template<class Model, class Key, class Hash = std::hash<Key>>
+class HashIndex
+    : public details::MapIndex<Model, Key,
+        std::unordered_multimap<Key, typename details::ModelPtrTraits<Model>::PtrC, Hash>>
+{
+    using Base = details::MapIndex<Model, Key,
+        std::unordered_multimap<Key, typename details::ModelPtrTraits<Model>::PtrC, Hash>>;
+public:
+    using Base::Base;
+};
+
+//! Index of models by a field with O(log n) lookups and range queries
+template<class Model, class Key, class Compare = std::less<Key>>
+class OrderedIndex
+    : public details::MapIndex<Model, Key,
+        std::multimap<Key, typename details::ModelPtrTraits<Model>::PtrC, Compare>>
+{
+    using Base = details::MapIndex<Model, Key,
+        std::multimap<Key, typename details::ModelPtrTraits<Model>::PtrC, Compare>>;
+public:
+    using typename Base::Range;
+    using Base::Base;
+
+    // Models with keys in [from, to]
+    Range range(const Key & from, const Key & to) const
+    {
+        return {this->m_map.lower_bound(from), this->m_map.upper_bound(to)};
+    }
+};
+
+} // namespace mvc
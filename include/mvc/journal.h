@@ -0,0 +1,391 @@
+#pragma once
+
+#include <chrono>
+#include <cassert>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+
+#include "model_set.h"
+#include "snapshot.h"
+
+
+namespace mvc {
+
+//! Durability of a journal, see Controller::openJournal
+struct JournalOptions
+{
+    enum class Sync
+    {
+        // Records are written at the end of every drain, the system decides when they
+        // reach the storage device
+        Never,
+        // Records of a drain are written and synced together (group commit). A drain is one
+        // request made outside of batches, a batch, or for ConcurrentController a pass of
+        // queued requests (up to ConcurrentController::MaxPassSize of them)
+        EveryDrain,
+        // Records are kept in memory, a background thread writes and syncs them once per
+        // interval, so a crash loses the records of one interval at most
+        Interval,
+    };
+
+    Sync sync = Sync::EveryDrain;
+    std::chrono::milliseconds interval{50};
+};
+
+//! Counters of a journal, see Controller::journalStats
+struct JournalStats
+{
+    bool ok = true;        // false after a failed write or sync, later records are dropped
+    uint64_t records = 0;  // records written to the file
+    uint64_t bytes = 0;    // bytes of records written to the file
+    uint64_t dropped = 0;  // records which weren't written because of a failure
+};
+
+//! Append-only log of changes of a model set:
+//!     header | record | record | ...
+//! A record is its size and checksum (32 bits each) followed by an event of mvc/codec.h:
+//! a creation with all fields of the model, an update with the changed fields or a removal.
+//! Only fields of the field list are recorded, it must cover the whole state of the model.
+//! Models are told apart by keys given by the journal. Replay stops at the first incomplete record or
+//! one with a wrong checksum (the tail of a write interrupted by a crash), it is cut off before new
+//! records are appended. An intact record which doesn't fit the replayed models (an update of an
+//! unknown model, a second creation) fails the replay and the file is left as it is.
+struct JournalHeader
+{
+    static constexpr uint32_t Magic = 0x4a43564d; // "MVCJ"
+    static constexpr uint32_t Version = 2;
+
+    uint32_t magic = Magic;
+    uint32_t version = Version;
+    uint64_t schema = 0; // signature of the field list, as in snapshots
+};
+
+namespace details {
+
+inline uint32_t journalChecksum(const char * data, size_t size)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Journal of a controller: it encodes applied events into a buffer and writes the buffer
+// when the controller finishes a drain, or on a background thread for Sync::Interval.
+// Models are told apart by keys given at creation. After a failed write the file isn't
+// written any more, records are counted as dropped until the journal is compacted
+template<class Model>
+class Journal
+{
+public:
+    // size and checksum of a record
+    enum : size_t { PrefixSize = 2 * sizeof(uint32_t) };
+
+    explicit Journal(JournalOptions options)
+        : m_options(options)
+    {}
+
+    ~Journal()
+    {
+        if (m_flusher.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_wake.notify_one();
+            m_flusher.join();
+            m_shared = false;
+        }
+        if (m_file != nullptr) {
+            write();
+            std::fclose(m_file);
+        }
+    }
+
+    Journal(const Journal &) = delete;
+    Journal & operator =(const Journal &) = delete;
+
+    // Calls "fun(const EventView<Model> &)" for every record of the file, "fun" returns
+    // false for a record it can't use. A tail with a wrong size or checksum is removed from
+    // the file. Returns false and leaves the file as it is if it can't be read, belongs to
+    // another model or has a record which "fun" rejects. A missing file is an empty journal
+    template<class Fun>
+    static bool replay(const std::string & path, Fun && fun)
+    {
+        MappedFile file(path);
+        if (file.missing())
+            return true;
+        if (!file.valid() && !file.empty())
+            return false;
+        if (file.size() < sizeof(JournalHeader))
+            return rewrite(path, nullptr, 0); // an interrupted creation, the file is started anew
+        JournalHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (header.magic != JournalHeader::Magic || header.version != JournalHeader::Version ||
+            header.schema != schemaOf<Model>())
+            return false;
+
+        const char * pos = file.data() + sizeof(header);
+        const char * end = file.data() + file.size();
+        while (static_cast<size_t>(end - pos) >= PrefixSize) {
+            uint32_t size = 0, checksum = 0;
+            std::memcpy(&size, pos, sizeof(size));
+            std::memcpy(&checksum, pos + sizeof(size), sizeof(checksum));
+            const char * record = pos + PrefixSize;
+            if (size > static_cast<size_t>(end - record) || journalChecksum(record, size) != checksum)
+                break;
+            // an intact record which can't be used isn't a torn write, later records are kept
+            EventView<Model> event(record, size);
+            if (!event.valid() || event.size() != size || !fun(event))
+                return false;
+            pos = record + size;
+        }
+
+        if (pos != end)
+            return rewrite(path, file.data(), static_cast<size_t>(pos - file.data()));
+        return true;
+    }
+
+    // Opens the file for appending, a new file or one without a complete header gets the header
+    bool open(const std::string & path)
+    {
+        if (!openFile(path))
+            return false;
+        if (m_options.sync == JournalOptions::Sync::Interval) {
+            m_shared = true;
+            m_flusher = std::thread([this]{ flushPeriodically(); });
+        }
+        return true;
+    }
+
+    // The model is known by the key from a replayed record
+    void assign(const Model * model, uint64_t key)
+    {
+        m_keys[model] = key;
+        if (key >= m_nextKey)
+            m_nextKey = key + 1;
+    }
+    bool knows(const Model * model) const { return m_keys.count(model) != 0; }
+
+    void created(const Model & model)
+    {
+        const uint64_t key = m_nextKey++;
+        m_keys[&model] = key;
+        append(EventType::Create, key, &model, AllFields, IsReflected<Model>());
+    }
+
+    // The model has the new state already, "changes" are the fields which differ from the previous one.
+    // Every applied update is recorded, also one which changed no listed field
+    void updated(const Model & model, ChangeMask changes)
+    {
+        append(EventType::Update, m_keys.at(&model), &model, changes, IsReflected<Model>());
+    }
+
+    void removed(const Model & model)
+    {
+        auto it = m_keys.find(&model);
+        assert(it != m_keys.end() && "The model isn't in the journal");
+        append(EventType::Remove, it->second, nullptr, 0, IsReflected<Model>());
+        m_keys.erase(it);
+    }
+
+    // Writes buffered records, and syncs them by the options. Records of Sync::Interval
+    // are left to the background thread unless "force" is set. Returns false if any
+    // write failed
+    bool commit(bool force)
+    {
+        if (m_options.sync == JournalOptions::Sync::Interval && !force)
+            return stats().ok;
+        return write();
+    }
+
+    // Replaces the file with creations of the models, keys are given anew. A journal
+    // which failed to write is recovered by it
+    template<class Models>
+    bool compact(const Models & models)
+    {
+        std::lock_guard<std::mutex> fileLock(m_fileMutex);
+        {
+            auto lock = lockBuffer();
+            m_buffer.clear(); // states of the models include buffered records
+            m_pending = 0;
+            m_stats.ok = true;
+        }
+        m_keys.clear();
+        m_nextKey = 0;
+        JournalHeader header;
+        header.schema = schemaOf<Model>();
+        std::vector<char> buffer(reinterpret_cast<const char *>(&header),
+                                 reinterpret_cast<const char *>(&header) + sizeof(header));
+        for (auto && model : models)
+            created(*model);
+
+        auto lock = lockBuffer();
+        buffer.insert(buffer.end(), m_buffer.begin(), m_buffer.end());
+        m_buffer.clear();
+        if (m_file != nullptr)
+            std::fclose(m_file); // a failed compaction may have left the journal without a file
+        m_file = nullptr;
+        m_stats.ok = rewrite(m_path, buffer.data(), buffer.size()) && openFile(m_path);
+        if (m_stats.ok) {
+            m_stats.records += m_pending;
+            m_stats.bytes += buffer.size() - sizeof(header);
+        } else {
+            m_stats.dropped += m_pending;
+        }
+        m_pending = 0;
+        return m_stats.ok;
+    }
+
+    JournalStats stats()
+    {
+        auto lock = lockBuffer();
+        return m_stats;
+    }
+
+private:
+    bool openFile(const std::string & path)
+    {
+        m_path = path;
+        m_file = std::fopen(path.c_str(), "ab");
+        if (m_file == nullptr || std::fseek(m_file, 0, SEEK_END) != 0)
+            return false;
+        const long size = std::ftell(m_file);
+        if (size < 0)
+            return false;
+        if (static_cast<size_t>(size) >= sizeof(JournalHeader))
+            return true;
+        if (size > 0) {
+            // the rest of an interrupted creation, records mustn't follow it
+            std::fclose(m_file);
+            m_file = nullptr;
+            if (!rewrite(path, nullptr, 0) || (m_file = std::fopen(path.c_str(), "ab")) == nullptr)
+                return false;
+        }
+        JournalHeader header;
+        header.schema = schemaOf<Model>();
+        return std::fwrite(&header, sizeof(header), 1, m_file) == 1 && syncFile(m_file);
+    }
+
+    // A controller of a model without a field list never opens a journal
+    void append(EventType, uint64_t, const Model *, ChangeMask, std::false_type) {}
+
+    void append(EventType type, uint64_t key, const Model * model, ChangeMask fields, std::true_type)
+    {
+        auto lock = lockBuffer();
+        if (!m_stats.ok) {
+            ++m_stats.dropped;
+            return;
+        }
+        const size_t start = m_buffer.size();
+        m_buffer.resize(start + PrefixSize);
+        if (!encodeEvent(m_buffer, type, key, model, fields) ||
+            m_buffer.size() - start - PrefixSize > UINT32_MAX) {
+            // later records would refer to the missing one
+            m_buffer.resize(start);
+            m_stats.ok = false;
+            ++m_stats.dropped;
+            return;
+        }
+        ++m_pending;
+
+        const auto size = static_cast<uint32_t>(m_buffer.size() - start - PrefixSize);
+        const auto checksum = journalChecksum(m_buffer.data() + start + PrefixSize, size);
+        std::memcpy(m_buffer.data() + start, &size, sizeof(size));
+        std::memcpy(m_buffer.data() + start + sizeof(size), &checksum, sizeof(checksum));
+    }
+
+    // Writes and syncs buffered records, the buffer is released while the file is written
+    bool write()
+    {
+        std::lock_guard<std::mutex> fileLock(m_fileMutex);
+        size_t records = 0;
+        {
+            auto lock = lockBuffer();
+            m_writing.swap(m_buffer);
+            std::swap(records, m_pending);
+        }
+        bool ok = true;
+        if (!m_writing.empty()) {
+            ok = std::fwrite(m_writing.data(), 1, m_writing.size(), m_file) == m_writing.size() &&
+                 (m_options.sync == JournalOptions::Sync::Never ? std::fflush(m_file) == 0 : syncFile(m_file));
+        }
+
+        auto lock = lockBuffer();
+        if (ok) {
+            m_stats.records += records;
+            m_stats.bytes += m_writing.size();
+        } else {
+            // the file may have a part of the records, which replay cuts off as a damaged tail
+            m_stats.ok = false;
+            m_stats.dropped += records;
+        }
+        m_writing.clear();
+        return m_stats.ok;
+    }
+
+    // Body of the background thread of Sync::Interval
+    void flushPeriodically()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_wake.wait_for(lock, m_options.interval, [this]{ return m_stop; })) {
+            lock.unlock();
+            write();
+            lock.lock();
+        }
+    }
+
+    // The buffer and the counters are shared with the background thread of Sync::Interval only
+    std::unique_lock<std::mutex> lockBuffer()
+    {
+        return m_shared ? std::unique_lock<std::mutex>(m_mutex) : std::unique_lock<std::mutex>();
+    }
+
+    // Writes the data to a temporary file which replaces the file
+    static bool rewrite(const std::string & path, const char * data, size_t size)
+    {
+        const auto temp = path + ".tmp";
+        std::FILE * file = std::fopen(temp.c_str(), "wb");
+        if (file == nullptr)
+            return false;
+        bool ok = (size == 0 || std::fwrite(data, 1, size, file) == size) && syncFile(file);
+        ok = std::fclose(file) == 0 && ok;
+        ok = ok && replaceFile(temp, path);
+        if (!ok)
+            std::remove(temp.c_str());
+        return ok;
+    }
+
+private:
+    JournalOptions m_options;
+    std::string m_path;
+    std::unordered_map<const Model *, uint64_t> m_keys;
+    uint64_t m_nextKey = 0;
+
+    std::mutex m_fileMutex; // the file and m_writing
+    std::FILE * m_file = nullptr;
+    std::vector<char> m_writing; // records which are being written
+
+    std::mutex m_mutex; // the rest, when m_shared is set
+    bool m_shared = false;
+    std::vector<char> m_buffer; // records which aren't written yet
+    size_t m_pending = 0;       // number of records in m_buffer
+    JournalStats m_stats;
+    bool m_stop = false;
+    std::condition_variable m_wake;
+    std::thread m_flusher;
+};
+
+} // namespace details
+} // namespace mvc
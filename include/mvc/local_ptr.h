@@ -0,0 +1,193 @@
+#pragma once
+
+#include <new>
+#include <memory>
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#ifndef NDEBUG
+#include <thread>
+#endif
+
+
+namespace mvc {
+
+namespace details {
+
+// Reference count which is allocated together with the object
+struct LocalBlock
+{
+    size_t refs = 1;
+    void (*destroy)(LocalBlock * block) = nullptr;
+#ifndef NDEBUG
+    std::thread::id owner = std::this_thread::get_id();
+
+    void check() const
+    {
+        assert(owner == std::this_thread::get_id() &&
+               "mvc::LocalPtr is used by a thread which doesn't own the object");
+    }
+#endif
+};
+
+template<class T, class Alloc>
+struct LocalNode : LocalBlock
+{
+    using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<LocalNode>;
+
+    NodeAlloc alloc;
+    T value;
+
+    template<class... Args>
+    LocalNode(const Alloc & allocator, Args && ... args)
+        : alloc(allocator)
+        , value(std::forward<Args>(args)...)
+    {
+        destroy = [](LocalBlock * block) {
+            auto node = static_cast<LocalNode *>(block);
+            NodeAlloc alloc = std::move(node->alloc);
+            node->~LocalNode();
+            std::allocator_traits<NodeAlloc>::deallocate(alloc, node, 1);
+        };
+    }
+};
+
+} // namespace details
+
+//! Reference counted pointer for objects used by one thread. It has the interface of
+//! std::shared_ptr, but the counter isn't atomic. Debug builds assert that the pointer
+//! is copied and released only by the thread which created the object.
+template<class T>
+class LocalPtr
+{
+    template<class U> friend class LocalPtr;
+    template<class U, class Alloc, class... Args>
+    friend LocalPtr<U> allocateLocal(const Alloc & alloc, Args && ... args);
+
+    details::LocalBlock * m_block = nullptr;
+    T * m_ptr = nullptr;
+
+    LocalPtr(details::LocalBlock * block, T * ptr) : m_block(block), m_ptr(ptr) {}
+
+public:
+    using element_type = T;
+
+    LocalPtr() = default;
+    LocalPtr(std::nullptr_t) {}
+
+    LocalPtr(const LocalPtr & other) : m_block(other.m_block), m_ptr(other.m_ptr) { acquire(); }
+    LocalPtr(LocalPtr && other) : m_block(other.m_block), m_ptr(other.m_ptr)
+    {
+        other.m_block = nullptr;
+        other.m_ptr = nullptr;
+    }
+
+    // Conversion to a pointer to const
+    template<class U, class = std::enable_if_t<std::is_convertible<U *, T *>::value>>
+    LocalPtr(const LocalPtr<U> & other) : m_block(other.m_block), m_ptr(other.m_ptr) { acquire(); }
+    template<class U, class = std::enable_if_t<std::is_convertible<U *, T *>::value>>
+    LocalPtr(LocalPtr<U> && other) : m_block(other.m_block), m_ptr(other.m_ptr)
+    {
+        other.m_block = nullptr;
+        other.m_ptr = nullptr;
+    }
+
+    ~LocalPtr() { release(); }
+
+    LocalPtr & operator =(LocalPtr other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    void swap(LocalPtr & other)
+    {
+        std::swap(m_block, other.m_block);
+        std::swap(m_ptr, other.m_ptr);
+    }
+
+    void reset() { LocalPtr().swap(*this); }
+
+    T * get() const { return m_ptr; }
+    T & operator *() const { return *m_ptr; }
+    T * operator ->() const { return m_ptr; }
+    explicit operator bool() const { return m_ptr != nullptr; }
+
+    long use_count() const { return m_block ? static_cast<long>(m_block->refs) : 0; }
+
+private:
+    void acquire()
+    {
+        if (m_block == nullptr)
+            return;
+#ifndef NDEBUG
+        m_block->check();
+#endif
+        ++m_block->refs;
+    }
+
+    void release()
+    {
+        if (m_block == nullptr)
+            return;
+#ifndef NDEBUG
+        m_block->check();
+#endif
+        if (--m_block->refs == 0)
+            m_block->destroy(m_block);
+    }
+};
+
+template<class T, class U>
+bool operator ==(const LocalPtr<T> & lhs, const LocalPtr<U> & rhs) { return lhs.get() == rhs.get(); }
+template<class T, class U>
+bool operator !=(const LocalPtr<T> & lhs, const LocalPtr<U> & rhs) { return lhs.get() != rhs.get(); }
+template<class T>
+bool operator ==(const LocalPtr<T> & ptr, std::nullptr_t) { return !ptr; }
+template<class T>
+bool operator ==(std::nullptr_t, const LocalPtr<T> & ptr) { return !ptr; }
+template<class T>
+bool operator !=(const LocalPtr<T> & ptr, std::nullptr_t) { return bool(ptr); }
+template<class T>
+bool operator !=(std::nullptr_t, const LocalPtr<T> & ptr) { return bool(ptr); }
+template<class T, class U>
+bool operator <(const LocalPtr<T> & lhs, const LocalPtr<U> & rhs)
+{
+    return std::less<const void *>()(lhs.get(), rhs.get());
+}
+
+// Allocates the object and its counter in one block, like std::allocate_shared
+template<class T, class Alloc, class... Args>
+LocalPtr<T> allocateLocal(const Alloc & alloc, Args && ... args)
+{
+    using Node = details::LocalNode<std::remove_const_t<T>, Alloc>;
+    typename Node::NodeAlloc nodeAlloc(alloc);
+    auto node = std::allocator_traits<typename Node::NodeAlloc>::allocate(nodeAlloc, 1);
+    try {
+        new (node) Node(alloc, std::forward<Args>(args)...);
+    } catch (...) {
+        std::allocator_traits<typename Node::NodeAlloc>::deallocate(nodeAlloc, node, 1);
+        throw;
+    }
+    return LocalPtr<T>(node, &node->value);
+}
+
+template<class T, class... Args>
+LocalPtr<T> makeLocal(Args && ... args)
+{
+    return allocateLocal<T>(std::allocator<std::remove_const_t<T>>(), std::forward<Args>(args)...);
+}
+
+} // namespace mvc
+
+namespace std {
+
+template<class T>
+struct hash<mvc::LocalPtr<T>>
+{
+    size_t operator()(const mvc::LocalPtr<T> & ptr) const { return hash<T *>()(ptr.get()); }
+};
+
+} // namespace std
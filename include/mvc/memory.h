@@ -0,0 +1,260 @@
+#pragma once
+
+#include <cassert>
+
+#include <new>
+#include <memory>
+#include <algorithm>
+#include <vector>
+#include <cstddef>
+
+
+namespace mvc {
+
+//! Source of memory for model objects, a C++14 stand-in for std::pmr::memory_resource
+class MemoryResource
+{
+public:
+    virtual ~MemoryResource() = default;
+
+    virtual void * allocate(size_t bytes, size_t alignment) = 0;
+    virtual void deallocate(void * ptr, size_t bytes, size_t alignment) = 0;
+};
+
+using MemoryResourcePtr = std::shared_ptr<MemoryResource>;
+
+//! Pool of fixed size blocks grouped by size classes. Freed blocks go to a free list
+//! of their class and are handed out again first, so repeatedly created and dropped
+//! objects of the same type reuse the same memory. Memory is returned to the heap
+//! only when the pool is destroyed. The pool is not thread-safe.
+class PoolResource : public MemoryResource
+{
+    static constexpr size_t Granularity = alignof(std::max_align_t);
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    struct Block { Block * next; };
+
+    std::vector<Block *> m_free; // free list heads, one per size class
+    std::vector<void *> m_chunks;
+    size_t m_maxBlockSize;
+    size_t m_reserved = 0;
+    size_t m_used = 0;
+
+public:
+    // Allocations bigger than "maxBlockSize" go directly to the heap
+    explicit PoolResource(size_t maxBlockSize = 1024)
+        : m_free((maxBlockSize + Granularity - 1) / Granularity, nullptr)
+        , m_maxBlockSize(m_free.size() * Granularity)
+    {}
+
+    PoolResource(const PoolResource &) = delete;
+    PoolResource & operator =(const PoolResource &) = delete;
+
+    ~PoolResource() override
+    {
+        assert(m_used == 0 && "All pooled objects must be released before the pool");
+        for (auto chunk : m_chunks)
+            ::operator delete(chunk);
+    }
+
+    void * allocate(size_t bytes, size_t alignment) override
+    {
+        assert(alignment <= Granularity && "Over-aligned types are not supported");
+        (void)alignment;
+        if (bytes == 0 || bytes > m_maxBlockSize)
+            return ::operator new(bytes);
+
+        ++m_used;
+        auto & head = m_free[sizeClass(bytes)];
+        if (head == nullptr)
+            refill(sizeClass(bytes));
+        auto block = head;
+        head = block->next;
+        return block;
+    }
+
+    void deallocate(void * ptr, size_t bytes, size_t /*alignment*/) override
+    {
+        if (bytes == 0 || bytes > m_maxBlockSize)
+            return ::operator delete(ptr);
+
+        --m_used;
+        auto & head = m_free[sizeClass(bytes)];
+        head = new (ptr) Block{head};
+    }
+
+    // Bytes requested from the heap for pooled blocks
+    size_t reserved() const { return m_reserved; }
+    // Number of pooled blocks in use
+    size_t used() const { return m_used; }
+
+private:
+    static size_t sizeClass(size_t bytes) { return (bytes - 1) / Granularity; }
+
+    void refill(size_t sizeClass)
+    {
+        const size_t blockSize = (sizeClass + 1) * Granularity;
+        const size_t count = ChunkSize / blockSize > 0 ? ChunkSize / blockSize : 1;
+        auto chunk = static_cast<char *>(::operator new(count * blockSize));
+        m_chunks.push_back(chunk);
+        m_reserved += count * blockSize;
+
+        auto & head = m_free[sizeClass];
+        for (size_t i = count; i-- > 0;)
+            head = new (chunk + i * blockSize) Block{head};
+    }
+};
+
+//! Monotonic buffer: allocation bumps a pointer inside the current chunk, deallocation only
+//! counts live objects and "release" resets the chunk in O(1) when nothing in it is alive.
+//! A chunk with live objects (they escaped, e.g. a view kept them) is retired instead and
+//! goes back to the heap with its last object. The arena is created on the heap and
+//! "destroy" defers deletion until all its objects are released. Not thread-safe.
+class MonotonicArena : public MemoryResource
+{
+    static constexpr size_t Align = alignof(std::max_align_t);
+
+    struct alignas(std::max_align_t) Chunk
+    {
+        size_t live;
+        bool retired;
+    };
+
+    // Precedes every allocation
+    struct alignas(std::max_align_t) Header
+    {
+        Chunk * chunk;
+    };
+
+    size_t m_chunkSize;
+    Chunk * m_chunk = nullptr;
+    char * m_ptr = nullptr;
+    char * m_end = nullptr;
+    size_t m_live = 0;
+    bool m_destroyed = false;
+
+    explicit MonotonicArena(size_t chunkSize) : m_chunkSize(chunkSize) {}
+    ~MonotonicArena() override
+    {
+        if (m_chunk != nullptr)
+            ::operator delete(m_chunk);
+    }
+
+public:
+    struct Deleter
+    {
+        void operator ()(MonotonicArena * arena) const { arena->destroy(); }
+    };
+    using Ptr = std::unique_ptr<MonotonicArena, Deleter>;
+
+    static Ptr create(size_t chunkSize = 16 * 1024)
+    {
+        return Ptr(new MonotonicArena(chunkSize));
+    }
+
+    void * allocate(size_t bytes, size_t alignment) override
+    {
+        assert(alignment <= Align && "Over-aligned types are not supported");
+        (void)alignment;
+        const size_t size = sizeof(Header) + (bytes + Align - 1) / Align * Align;
+        if (m_chunk == nullptr || size > static_cast<size_t>(m_end - m_ptr)) {
+            release();
+            if (m_chunk == nullptr || size > static_cast<size_t>(m_end - m_ptr)) {
+                retire();
+                const size_t chunkSize = sizeof(Chunk) + std::max(m_chunkSize, size);
+                m_chunk = new (::operator new(chunkSize)) Chunk{0, false};
+                m_ptr = begin();
+                m_end = reinterpret_cast<char *>(m_chunk) + chunkSize;
+            }
+        }
+
+        auto header = new (m_ptr) Header{m_chunk};
+        m_ptr += size;
+        ++m_chunk->live;
+        ++m_live;
+        return header + 1;
+    }
+
+    void deallocate(void * ptr, size_t /*bytes*/, size_t /*alignment*/) override
+    {
+        auto chunk = (static_cast<Header *>(ptr) - 1)->chunk;
+        if (--chunk->live == 0 && chunk->retired)
+            ::operator delete(chunk);
+        if (--m_live == 0 && m_destroyed)
+            delete this;
+    }
+
+    // Drops all allocations of the current chunk, or retires it if some are still alive
+    void release()
+    {
+        if (m_chunk != nullptr && m_chunk->live == 0)
+            m_ptr = begin();
+        else
+            retire();
+    }
+
+    // Number of allocated and not yet deallocated objects
+    size_t live() const { return m_live; }
+
+private:
+    char * begin() const { return reinterpret_cast<char *>(m_chunk) + sizeof(Chunk); }
+
+    void retire()
+    {
+        if (m_chunk == nullptr)
+            return;
+        if (m_chunk->live == 0)
+            ::operator delete(m_chunk);
+        else
+            m_chunk->retired = true;
+        m_chunk = nullptr;
+        m_ptr = m_end = nullptr;
+    }
+
+    void destroy()
+    {
+        m_destroyed = true;
+        if (m_live == 0)
+            delete this;
+    }
+};
+
+//! Standard allocator on top of a memory resource. Like std::pmr::polymorphic_allocator
+//! it doesn't own the resource, the resource must outlive all objects allocated from it.
+template<class T>
+class ResourceAllocator
+{
+    template<class U> friend class ResourceAllocator;
+    MemoryResource * m_resource;
+
+public:
+    using value_type = T;
+
+    explicit ResourceAllocator(MemoryResource * resource)
+        : m_resource(resource)
+    {}
+
+    template<class U>
+    ResourceAllocator(const ResourceAllocator<U> & other)
+        : m_resource(other.m_resource)
+    {}
+
+    T * allocate(size_t count)
+    {
+        return static_cast<T *>(m_resource->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T * ptr, size_t count)
+    {
+        m_resource->deallocate(ptr, count * sizeof(T), alignof(T));
+    }
+
+    MemoryResource * resource() const { return m_resource; }
+
+    template<class U>
+    bool operator ==(const ResourceAllocator<U> & other) const { return m_resource == other.m_resource; }
+    template<class U>
+    bool operator !=(const ResourceAllocator<U> & other) const { return m_resource != other.m_resource; }
+};
+
+} // namespace mvc
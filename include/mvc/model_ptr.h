@@ -0,0 +1,83 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+
+#include "local_ptr.h"
+#include "details/traits.h"
+
+
+namespace mvc {
+
+//! Ownership of model objects, a model class selects it with a member type:
+//!     struct MyModel { using Ownership = mvc::LocalOwnership; ... };
+//! Models are owned by std::shared_ptr by default. LocalOwnership switches them to
+//! mvc::LocalPtr with a non-atomic counter, such models and everything which refers to
+//! them (controllers, views, requests) must stay on one thread.
+struct SharedOwnership {};
+struct LocalOwnership {};
+
+namespace details {
+
+template<class Model, class = void>
+struct OwnershipOf
+{
+    using type = SharedOwnership;
+};
+
+template<class Model>
+struct OwnershipOf<Model, VoidT<typename Model::Ownership>>
+{
+    using type = typename Model::Ownership;
+};
+
+template<class Model, class Ownership = typename OwnershipOf<Model>::type>
+struct ModelPtrTraits;
+
+template<class Model>
+struct ModelPtrTraits<Model, SharedOwnership>
+{
+    using Ptr = std::shared_ptr<Model>;
+    using PtrC = std::shared_ptr<const Model>;
+
+    template<class... Args>
+    static Ptr make(Args && ... args)
+    {
+        return std::make_shared<Model>(std::forward<Args>(args)...);
+    }
+
+    template<class Alloc, class... Args>
+    static Ptr allocate(const Alloc & alloc, Args && ... args)
+    {
+        return std::allocate_shared<Model>(alloc, std::forward<Args>(args)...);
+    }
+};
+
+template<class Model>
+struct ModelPtrTraits<Model, LocalOwnership>
+{
+    using Ptr = LocalPtr<Model>;
+    using PtrC = LocalPtr<const Model>;
+
+    template<class... Args>
+    static Ptr make(Args && ... args)
+    {
+        return makeLocal<Model>(std::forward<Args>(args)...);
+    }
+
+    template<class Alloc, class... Args>
+    static Ptr allocate(const Alloc & alloc, Args && ... args)
+    {
+        return allocateLocal<Model>(alloc, std::forward<Args>(args)...);
+    }
+};
+
+} // namespace details
+
+template<class Model>
+constexpr bool isLocalModel()
+{
+    return std::is_same<typename details::OwnershipOf<Model>::type, LocalOwnership>::value;
+}
+
+} // namespace mvc
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+
+#include "model_ptr.h"
+#include "details/slot_map.h"
+
+
+namespace mvc {
+
+//! Handle of a model object in a controller, it stays valid until the model is removed
+using ModelId = details::SlotId;
+
+//! Model objects of a controller. They are stored contiguously and iterated as an array,
+//! a model is found by its id without hashing or by its pointer through an index.
+template<class Model>
+class ModelSet
+{
+public:
+    using ModelPtrC = typename details::ModelPtrTraits<Model>::PtrC;
+    using const_iterator = typename details::SlotMap<ModelPtrC>::const_iterator;
+    using iterator = const_iterator;
+
+    const_iterator begin() const { return m_models.begin(); }
+    const_iterator end() const { return m_models.end(); }
+    size_t size() const { return m_models.size(); }
+    bool empty() const { return m_models.empty(); }
+
+    const_iterator find(const ModelPtrC & model) const
+    {
+        auto it = m_ids.find(model.get());
+        if (it == m_ids.end())
+            return end();
+        return m_models.iteratorOf(it->second);
+    }
+    size_t count(const ModelPtrC & model) const { return m_ids.count(model.get()); }
+
+    // Returns null if the model is removed
+    ModelPtrC find(ModelId id) const
+    {
+        auto model = m_models.find(id);
+        return model ? *model : ModelPtrC();
+    }
+
+    // Returns an invalid id if the model isn't in the set
+    ModelId idOf(const ModelPtrC & model) const
+    {
+        auto it = m_ids.find(model.get());
+        return it == m_ids.end() ? ModelId() : it->second;
+    }
+
+    // Id of the model at the position of the iteration order
+    ModelId idAt(size_t position) const { return m_models.idAt(position); }
+
+    ModelId insert(ModelPtrC model)
+    {
+        auto ptr = model.get();
+        auto id = m_models.insert(std::move(model));
+        m_ids.emplace(ptr, id);
+        return id;
+    }
+
+    // A model which isn't in the set is ignored
+    void erase(const ModelPtrC & model)
+    {
+        auto it = m_ids.find(model.get());
+        if (it == m_ids.end())
+            return;
+        m_models.erase(it->second);
+        m_ids.erase(it);
+    }
+
+    void reserve(size_t size)
+    {
+        m_models.reserve(size);
+        m_ids.reserve(size);
+    }
+
+private:
+    details::SlotMap<ModelPtrC> m_models;
+    std::unordered_map<const Model *, ModelId> m_ids;
+};
+
+} // namespace mvc
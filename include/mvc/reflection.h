@@ -0,0 +1,173 @@
+#pragma once
+
+#include <tuple>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+#include <initializer_list>
+
+#include "details/traits.h"
+
+
+namespace mvc {
+
+//! Bit per reflected field of a model, in the order of the field list
+using ChangeMask = uint64_t;
+constexpr ChangeMask AllFields = ~ChangeMask(0);
+
+//! List of model fields (member pointers), a model declares it with a static function:
+//!     static auto fields() { return mvc::fields(&Page::url, &Page::status); }
+template<class Model, class... Types>
+struct FieldList
+{
+    static constexpr size_t size = sizeof...(Types);
+    static_assert(size <= 64, "ChangeMask has a bit for at most 64 fields");
+
+    std::tuple<Types Model::*...> members;
+};
+
+template<class Model, class... Types>
+FieldList<Model, Types...> fields(Types Model::*... members)
+{
+    return {std::make_tuple(members...)};
+}
+
+namespace details {
+
+template<class Model, class = void>
+struct IsReflected : std::false_type {};
+
+template<class Model>
+struct IsReflected<Model, VoidT<decltype(Model::fields())>> : std::true_type {};
+
+template<class Model, class... Types, class Fun, size_t... Index>
+void forEachField(const FieldList<Model, Types...> & list, Fun && fun, std::index_sequence<Index...>)
+{
+    (void)std::initializer_list<int>{(fun(Index, std::get<Index>(list.members)), 0)...};
+}
+
+template<class Model, class = void>
+struct IsEqualityComparable : std::false_type {};
+
+template<class Model>
+struct IsEqualityComparable<Model,
+    VoidT<decltype(std::declval<const Model &>() == std::declval<const Model &>())>> : std::true_type {};
+
+template<class T, class U>
+bool sameMember(T member, U other, std::true_type) { return member == other; }
+template<class T, class U>
+bool sameMember(T, U, std::false_type) { return false; }
+
+constexpr bool allOf(std::initializer_list<bool> values)
+{
+    for (bool value : values) {
+        if (!value)
+            return false;
+    }
+    return true;
+}
+
+constexpr bool anyOf(std::initializer_list<bool> values)
+{
+    for (bool value : values) {
+        if (value)
+            return true;
+    }
+    return false;
+}
+
+template<class T, class... Types>
+struct IsOneOf : std::integral_constant<bool, anyOf({std::is_same<T, Types>::value...})> {};
+
+// True if every type is a type of some field of the list
+template<class List, class... Types>
+struct AreFieldTypes;
+
+template<class Model, class... Fields, class... Types>
+struct AreFieldTypes<FieldList<Model, Fields...>, Types...>
+    : std::integral_constant<bool, allOf({IsOneOf<Types, Fields...>::value...})> {};
+
+} // namespace details
+
+template<class Model>
+constexpr bool isReflected() { return details::IsReflected<Model>::value; }
+
+//! Calls "fun(index, member)" for every reflected field of the model
+template<class Model, class Fun>
+void forEachField(Fun && fun)
+{
+    static const auto list = Model::fields();
+    details::forEachField(list, fun, std::make_index_sequence<decltype(list)::size>());
+}
+
+//! Mask of the given fields, e.g. "fieldMask(&Page::status, &Page::loadingProgress)".
+//! Every member must be in the field list of the model
+template<class Model, class... Types>
+ChangeMask fieldMask(Types Model::*... members)
+{
+    static_assert(isReflected<Model>(), "Fields are selected from the field list of the model");
+    static_assert(details::AreFieldTypes<decltype(Model::fields()), Types...>::value,
+                  "A member isn't in the field list of the model");
+    ChangeMask mask = 0;
+    auto add = [&mask](auto member) {
+        ChangeMask bits = 0;
+        forEachField<Model>([&bits, member](size_t index, auto field) {
+            if (details::sameMember(field, member, std::is_same<decltype(field), decltype(member)>()))
+                bits |= ChangeMask(1) << index;
+        });
+        assert(bits != 0 && "A member isn't in the field list of the model");
+        mask |= bits;
+    };
+    (void)std::initializer_list<int>{0, (add(members), 0)...};
+    return mask;
+}
+
+//! Fields which differ in the two states of a model, all bits for a model without a field list
+template<class Model>
+std::enable_if_t<isReflected<Model>(), ChangeMask> changedFields(const Model & model, const Model & from)
+{
+    ChangeMask mask = 0;
+    forEachField<Model>([&](size_t index, auto member) {
+        if (!(model.*member == from.*member))
+            mask |= ChangeMask(1) << index;
+    });
+    return mask;
+}
+
+template<class Model>
+std::enable_if_t<!isReflected<Model>(), ChangeMask> changedFields(const Model &, const Model &)
+{
+    return AllFields;
+}
+
+//! True if states of the model can be compared, by the field list or by operator ==
+template<class Model>
+constexpr bool isComparable()
+{
+    return isReflected<Model>() || details::IsEqualityComparable<Model>::value;
+}
+
+//! Compares two states of a model by operator == if there is one, otherwise by the field list,
+//! which sees only listed fields. States of a model which can't be compared are never the same
+template<class Model>
+std::enable_if_t<details::IsEqualityComparable<Model>::value, bool>
+sameState(const Model & model, const Model & from)
+{
+    return model == from;
+}
+
+template<class Model>
+std::enable_if_t<isReflected<Model>() && !details::IsEqualityComparable<Model>::value, bool>
+sameState(const Model & model, const Model & from)
+{
+    return changedFields(model, from) == 0;
+}
+
+template<class Model>
+std::enable_if_t<!isComparable<Model>(), bool> sameState(const Model &, const Model &)
+{
+    return false;
+}
+
+} // namespace mvc
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <iterator>
+
+#include "concurrent_controller.h"
+
+
+namespace mvc {
+
+//! Partitions models between N shards by a hash of the model object address. Every shard
+//! is a ConcurrentController with its own event queue, model set and worker thread, so
+//! requests of independent models are applied in parallel while requests of one model
+//! keep their order. "Shard" can be a ConcurrentController subclass with "aboutTo" hooks.
+//!
+//! Observers are called on the worker threads, concurrently for different shards, so
+//! they must be thread-safe. They are attached and "models" are read while the workers
+//! are stopped.
+template<class Model, class Shard = ConcurrentController<Model>>
+class ShardedController
+{
+    static_assert(!isLocalModel<Model>(), "Models of a sharded controller must be shared between threads");
+public:
+    using ModelPtr = typename Shard::ModelPtr;
+    using ModelPtrC = typename Shard::ModelPtrC;
+    using ViewPtr = typename Shard::ViewPtr;
+    using ShardPtr = std::shared_ptr<Shard>;
+
+    class ModelsView;
+
+    explicit ShardedController(size_t shards = std::thread::hardware_concurrency());
+    // All shards allocate models from the resource
+    ShardedController(size_t shards, MemoryResourcePtr resource);
+    ~ShardedController() { stop(); }
+
+    ShardedController(const ShardedController &) = delete;
+    ShardedController & operator =(const ShardedController &) = delete;
+
+    // Starts a worker thread per shard
+    void start();
+    // Applies all queued requests and joins the worker threads
+    void stop();
+
+    void attach(const ViewPtr & view);
+    void detach(const ViewPtr & view);
+
+    using ModelCreator = typename Shard::ModelCreator;
+    using ModelRemover = typename Shard::ModelRemover;
+    using ModelUpdater = typename Shard::ModelUpdater;
+
+    ModelCreator createRequest();
+    ModelRemover removeRequest(ModelPtrC model) { return shardOf(model.get())->removeRequest(std::move(model)); }
+    ModelUpdater updateRequest(ModelPtrC model) { return shardOf(model.get())->updateRequest(std::move(model)); }
+
+    // Models of all shards
+    ModelsView models() const { return ModelsView(m_shards); }
+
+    const std::vector<ShardPtr> & shards() const { return m_shards; }
+    const ShardPtr & shardOf(const Model * model) const;
+
+private:
+    std::vector<ShardPtr> m_shards;
+    std::vector<std::thread> m_workers;
+};
+
+//! Read-only range over model sets of all shards
+template<class Model, class Shard>
+class ShardedController<Model, Shard>::ModelsView
+{
+    using ShardIt = typename Shard::Models::const_iterator;
+    const std::vector<ShardPtr> & m_shards;
+
+public:
+    class const_iterator
+    {
+        const std::vector<ShardPtr> * m_shards;
+        size_t m_shard;
+        ShardIt m_it;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = ModelPtrC;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const ModelPtrC *;
+        using reference = const ModelPtrC &;
+
+        const_iterator(const std::vector<ShardPtr> & shards, size_t shard)
+            : m_shards(&shards)
+            , m_shard(shard)
+        {
+            if (m_shard < shards.size())
+                m_it = shards[m_shard]->models().begin();
+            skipEmpty();
+        }
+
+        reference operator *() const { return *m_it; }
+        pointer operator ->() const { return &*m_it; }
+
+        const_iterator & operator ++()
+        {
+            ++m_it;
+            skipEmpty();
+            return *this;
+        }
+
+        const_iterator operator ++(int)
+        {
+            auto it = *this;
+            ++*this;
+            return it;
+        }
+
+        bool operator ==(const const_iterator & other) const
+        {
+            return m_shard == other.m_shard && (m_shard == m_shards->size() || m_it == other.m_it);
+        }
+        bool operator !=(const const_iterator & other) const { return !(*this == other); }
+
+    private:
+        void skipEmpty()
+        {
+            while (m_shard < m_shards->size() && m_it == (*m_shards)[m_shard]->models().end()) {
+                if (++m_shard < m_shards->size())
+                    m_it = (*m_shards)[m_shard]->models().begin();
+            }
+        }
+    };
+    using iterator = const_iterator;
+
+    explicit ModelsView(const std::vector<ShardPtr> & shards) : m_shards(shards) {}
+
+    const_iterator begin() const { return const_iterator(m_shards, 0); }
+    const_iterator end() const { return const_iterator(m_shards, m_shards.size()); }
+
+    size_t size() const
+    {
+        size_t size = 0;
+        for (auto && shard : m_shards)
+            size += shard->models().size();
+        return size;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    size_t count(const ModelPtrC & model) const
+    {
+        return m_shards[shardIndex(m_shards.size(), model.get())]->models().count(model);
+    }
+
+    static size_t shardIndex(size_t shards, const Model * model)
+    {
+        // allocations are aligned, multiplicative hashing mixes the significant bits
+        auto key = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(model));
+        return static_cast<size_t>(((key >> 4) * 0x9E3779B97F4A7C15ull) >> 32) % shards;
+    }
+};
+
+template <class Model, class Shard>
+ShardedController<Model, Shard>::ShardedController(size_t shards)
+{
+    m_shards.resize(shards > 0 ? shards : 1);
+    for (auto && shard : m_shards)
+        shard = std::make_shared<Shard>();
+}
+
+template <class Model, class Shard>
+ShardedController<Model, Shard>::ShardedController(size_t shards, MemoryResourcePtr resource)
+{
+    m_shards.resize(shards > 0 ? shards : 1);
+    for (auto && shard : m_shards)
+        shard = std::make_shared<Shard>(resource);
+}
+
+template <class Model, class Shard>
+void ShardedController<Model, Shard>::start()
+{
+    assert(m_workers.empty() && "Shards are already started");
+    for (auto && shard : m_shards)
+        m_workers.emplace_back([shard] { shard->run(); });
+}
+
+template <class Model, class Shard>
+void ShardedController<Model, Shard>::stop()
+{
+    if (m_workers.empty())
+        return;
+    for (auto && shard : m_shards)
+        shard->stop();
+    for (auto && worker : m_workers)
+        worker.join();
+    m_workers.clear();
+}
+
+template <class Model, class Shard>
+void ShardedController<Model, Shard>::attach(const ViewPtr & view)
+{
+    assert(m_workers.empty() && "Views are attached to stopped shards");
+    for (auto && shard : m_shards)
+        shard->attach(view);
+}
+
+template <class Model, class Shard>
+void ShardedController<Model, Shard>::detach(const ViewPtr & view)
+{
+    assert(m_workers.empty() && "Views are detached from stopped shards");
+    for (auto && shard : m_shards)
+        shard->detach(view);
+}
+
+template <class Model, class Shard>
+auto ShardedController<Model, Shard>::createRequest() -> ModelCreator
+{
+    // the model is allocated first, its address selects the shard. All shards allocate
+    // from the same resource (or the heap), so the first one makes every model
+    auto model = static_cast<Controller<Model> &>(*m_shards.front()).makeModel();
+    auto & shard = *shardOf(model.get());
+    return ModelCreator(shard, std::move(model));
+}
+
+template <class Model, class Shard>
+auto ShardedController<Model, Shard>::shardOf(const Model * model) const -> const ShardPtr &
+{
+    return m_shards[ModelsView::shardIndex(m_shards.size(), model)];
+}
+
+} // namespace mvc
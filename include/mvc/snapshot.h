@@ -0,0 +1,159 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "codec.h"
+#include "details/mapped_file.h"
+
+
+namespace mvc {
+
+//! Binary snapshot of a model set, written by Controller::saveSnapshot:
+//!     header | record of the 1st model | record of the 2nd model | ...
+//! Records are encoded by mvc/codec.h, so models of a mapped snapshot can be read in place
+//! with RecordView. Numbers are in the byte order of the machine, a snapshot is read on the
+//! machine type which wrote it. A snapshot is rejected if its format version or the signature
+//! of the field list (number, order and types of fields) differs from the model being loaded.
+struct SnapshotHeader
+{
+    static constexpr uint32_t Magic = 0x5343564d; // "MVCS"
+    static constexpr uint32_t Version = 2;
+
+    uint32_t magic = Magic;
+    uint32_t version = Version;
+    uint64_t schema = 0; // signature of the field list
+    uint64_t count = 0;  // number of records
+    uint64_t size = 0;   // bytes of records after the header
+};
+
+namespace details {
+
+constexpr size_t SnapshotBufferSize = 1 << 16;
+
+// Flushes buffers of the file and waits until the storage device has the data
+inline bool syncFile(std::FILE * file)
+{
+    if (std::fflush(file) != 0)
+        return false;
+#if defined(__unix__) || defined(__APPLE__)
+    return ::fsync(::fileno(file)) == 0;
+#else
+    return true;
+#endif
+}
+
+// Renames the synced temporary file to the path and syncs the directory, so the
+// rename itself isn't lost in a crash
+inline bool replaceFile(const std::string & temp, const std::string & path)
+{
+    if (std::rename(temp.c_str(), path.c_str()) != 0)
+        return false;
+#if defined(__unix__) || defined(__APPLE__)
+    const auto slash = path.find_last_of('/');
+    const auto dir = slash == std::string::npos ? std::string(".") : path.substr(0, slash + 1);
+    const int fd = ::open(dir.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    const bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#else
+    return true;
+#endif
+}
+
+// Writes the models to a temporary file which replaces the file at the path when it is
+// complete, so a failed save keeps the previous snapshot. "forEachModel(fun)" passes every
+// model to "fun(const Model &)", the number of written bytes is added to "bytes"
+template<class Model, class ForEachModel>
+bool writeSnapshot(const std::string & path, ForEachModel && forEachModel, uint64_t * bytes = nullptr)
+{
+    static_assert(isReflected<Model>(), "Snapshots need the field list of the model");
+
+    const auto temp = path + ".tmp";
+    std::FILE * file = std::fopen(temp.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+
+    SnapshotHeader header;
+    header.schema = schemaOf<Model>();
+    // the header is rewritten when the sizes are known
+    std::vector<char> buffer(reinterpret_cast<const char *>(&header),
+                             reinterpret_cast<const char *>(&header) + sizeof(header));
+    uint64_t written = 0;
+    bool ok = true;
+    auto flush = [&]() {
+        ok = ok && std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+        written += buffer.size();
+        buffer.clear();
+    };
+    forEachModel([&](const Model & model) {
+        if (!encode(buffer, model)) {
+            ok = false; // a model which doesn't fit into a record
+            return;
+        }
+        ++header.count;
+        if (buffer.size() >= SnapshotBufferSize)
+            flush();
+    });
+    flush();
+    header.size = written - sizeof(header);
+    if (bytes != nullptr)
+        *bytes += written;
+
+    // the data must be on the device before the rename, or a crash can leave the
+    // snapshot with a part of it
+    ok = ok && std::fseek(file, 0, SEEK_SET) == 0 &&
+         std::fwrite(&header, sizeof(header), 1, file) == 1 && syncFile(file);
+    ok = std::fclose(file) == 0 && ok;
+    if (ok)
+        ok = replaceFile(temp, path);
+    if (!ok)
+        std::remove(temp.c_str());
+    return ok;
+}
+
+// Decodes all models of a snapshot into objects made by "make()", returns false
+// if the file can't be read or doesn't match the model
+template<class Model, class Make, class ModelPtr>
+bool readSnapshot(const std::string & path, Make && make, std::vector<ModelPtr> & models)
+{
+    static_assert(isReflected<Model>(), "Snapshots need the field list of the model");
+
+    MappedFile file(path);
+    if (!file.valid() || file.size() < sizeof(SnapshotHeader))
+        return false;
+    SnapshotHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != SnapshotHeader::Magic || header.version != SnapshotHeader::Version ||
+        header.schema != schemaOf<Model>() || header.size != file.size() - sizeof(header))
+        return false;
+
+    const char * pos = file.data() + sizeof(header);
+    const char * end = file.data() + file.size();
+    // every record takes at least a byte, a corrupted count mustn't reserve memory
+    models.reserve(models.size() + static_cast<size_t>(std::min<uint64_t>(header.count, header.size)));
+    for (uint64_t i = 0; i < header.count; ++i) {
+        RecordView<Model> record(pos, static_cast<size_t>(end - pos));
+        if (!record.valid())
+            return false;
+        ModelPtr model = make();
+        record.decode(*model);
+        models.push_back(std::move(model));
+        pos += record.size();
+    }
+    return pos == end;
+}
+
+} // namespace details
+} // namespace mvc
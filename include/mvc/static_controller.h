@@ -0,0 +1,134 @@
+#pragma once
+
+#include <tuple>
+#include <utility>
+#include <initializer_list>
+
+#include "controller.h"
+
+
+namespace mvc {
+namespace details {
+
+// Calls "updated(model, from, changes)" of a static view if it has one, otherwise "updated(model, from)"
+template<class View, class Ptr>
+auto notifyUpdated(View & view, const Ptr & model, const Ptr & from, ChangeMask changes, int)
+    -> decltype(view.updated(model, from, changes), void())
+{
+    view.updated(model, from, changes);
+}
+
+template<class View, class Ptr>
+void notifyUpdated(View & view, const Ptr & model, const Ptr & from, ChangeMask, long)
+{
+    view.updated(model, from);
+}
+
+} // namespace details
+
+//! Base of a view known at compile time. Callbacks aren't virtual, a derived view hides
+//! the ones it needs (CRTP), bulk callbacks pass every item to the derived view. A view
+//! gets the changed fields (see mvc::changedFields) if it declares
+//! "updated(model, from, ChangeMask changes)" instead of "updated(model, from)".
+template<class Derived, class Model>
+struct StaticView
+{
+    using ModelPtrC = typename details::ModelPtrTraits<Model>::PtrC;
+    using ModelsC = typename details::Observer<Model>::ModelsC;
+    using Updates = typename details::Observer<Model>::Updates;
+
+    void created(const ModelPtrC & /*model*/) {}
+    void removed(const ModelPtrC & /*model*/) {}
+    void updated(const ModelPtrC & /*model*/, const ModelPtrC & /*from*/) {}
+
+    void createdBatch(const ModelsC & models)
+    {
+        for (auto && model : models)
+            self().created(model);
+    }
+    void removedBatch(const ModelsC & models)
+    {
+        for (auto && model : models)
+            self().removed(model);
+    }
+    void updatedBatch(const Updates & updates)
+    {
+        for (auto && update : updates)
+            details::notifyUpdated(self(), update.model, update.from, update.changes, 0);
+    }
+
+private:
+    Derived & self() { return static_cast<Derived &>(*this); }
+};
+
+//! Controller which owns a fixed set of views. They are notified before dynamically
+//! attached views, in the order of the template arguments, without virtual calls.
+//! Views needn't derive from StaticView, any class with the callbacks of
+//! details::Observer (bulk ones included) will do.
+template<class Model, class... Views>
+class StaticController : public Controller<Model>
+{
+    using Base = Controller<Model>;
+public:
+    using typename Base::ModelPtrC;
+    using typename Base::ModelsC;
+    using typename Base::Updates;
+
+    using Base::Base;
+
+    template<size_t Index>
+    auto & view() { return std::get<Index>(m_views); }
+    template<class View>
+    View & view() { return std::get<View>(m_views); }
+
+protected:
+    void notifyCreated(const ModelPtrC & model) override
+    {
+        forEachView([&model](auto & view){ view.created(model); });
+        Base::notifyCreated(model);
+    }
+    void notifyRemoved(const ModelPtrC & model) override
+    {
+        forEachView([&model](auto & view){ view.removed(model); });
+        Base::notifyRemoved(model);
+    }
+    void notifyUpdated(const ModelPtrC & model, const ModelPtrC & from, ChangeMask changes) override
+    {
+        forEachView([&model, &from, changes](auto & view){ details::notifyUpdated(view, model, from, changes, 0); });
+        Base::notifyUpdated(model, from, changes);
+    }
+    void notifyCreatedBatch(const ModelsC & models) override
+    {
+        forEachView([&models](auto & view){ view.createdBatch(models); });
+        Base::notifyCreatedBatch(models);
+    }
+    void notifyRemovedBatch(const ModelsC & models) override
+    {
+        forEachView([&models](auto & view){ view.removedBatch(models); });
+        Base::notifyRemovedBatch(models);
+    }
+    void notifyUpdatedBatch(const Updates & updates) override
+    {
+        forEachView([&updates](auto & view){ view.updatedBatch(updates); });
+        Base::notifyUpdatedBatch(updates);
+    }
+
+private:
+    template<class Fun>
+    void forEachView(Fun && fun)
+    {
+        forEachView(fun, std::index_sequence_for<Views...>());
+    }
+
+    template<class Fun, size_t... Index>
+    void forEachView(Fun & fun, std::index_sequence<Index...>)
+    {
+        // expands to a sequence of calls in the order of the views
+        (void)std::initializer_list<int>{(fun(std::get<Index>(m_views)), 0)...};
+    }
+
+private:
+    std::tuple<Views...> m_views;
+};
+
+} // namespace mvc
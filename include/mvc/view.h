@@ -18,18 +18,18 @@ class View
 public:
     using CtrlPtr = std::shared_ptr<Controller<Model>>;
     using ViewPtr = std::shared_ptr<View<Model>>;
-    using ModelPtrC = std::shared_ptr<const Model>;
+    using ModelPtrC = typename details::ModelPtrTraits<Model>::PtrC;
 
     View(CtrlPtr ctrl)
-        : m_self(ViewPtr(this, [](auto){}))
-        , m_ctrl(std::move(ctrl))
+        : m_ctrl(std::move(ctrl))
     {
-        m_ctrl->attach(m_self);
+        m_ctrl->attach(*this);
     }
 
     auto createRequest() { return m_ctrl->createRequest(); }
     auto removeRequest(ModelPtrC model) { return m_ctrl->removeRequest(std::move(model)); }
     auto updateRequest(ModelPtrC model) { return m_ctrl->updateRequest(std::move(model)); }
+    auto batch() { return m_ctrl->batch(); }
 
     decltype(auto) models() const { return m_ctrl->models(); }
 
@@ -37,9 +37,11 @@ protected:
     using Obs::created;
     using Obs::updated;
     using Obs::removed;
+    using Obs::createdBatch;
+    using Obs::updatedBatch;
+    using Obs::removedBatch;
 
 private:
-    ViewPtr m_self;
     const CtrlPtr m_ctrl;
 };
 
@@ -0,0 +1,403 @@
+#include <mutex>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include <mvc/view.h>
+#include <mvc/concurrent_controller.h>
+#include <mvc/sharded_controller.h>
+
+
+namespace {
+
+struct Item
+{
+    int producer = 0;
+    int index = 0;
+    int value = 0;
+};
+
+using ItemController = mvc::ConcurrentController<Item>;
+
+struct Record
+{
+    int value = 0;
+
+    static auto fields() { return mvc::fields(&Record::value); }
+};
+
+// Is called on the owner thread only
+struct ItemView : mvc::View<Item>
+{
+    using BaseView = mvc::View<Item>;
+    using BaseView::BaseView;
+
+    std::vector<int> lastCreated; // index of the last created item per producer
+    bool ordered = true;
+    size_t createdCount = 0;
+    size_t updatedCount = 0;
+    size_t removedCount = 0;
+
+protected:
+    void created(const ModelPtrC & model) override
+    {
+        auto & last = lastCreated[model->producer];
+        ordered = ordered && model->index == last + 1;
+        last = model->index;
+        ++createdCount;
+    }
+    void updated(const ModelPtrC &, const ModelPtrC &) override
+    {
+        ++updatedCount;
+    }
+    void removed(const ModelPtrC &) override
+    {
+        ++removedCount;
+    }
+};
+
+} // namespace
+
+
+TEST_CASE("Concurrent controller applies requests of many threads in order", "[concurrent]")
+{
+    const int producers = 8;
+    const int items = 500;
+
+    auto ctrl = std::make_shared<ItemController>();
+    auto view = std::make_shared<ItemView>(ctrl);
+    view->lastCreated.assign(producers, -1);
+
+    std::thread owner([&ctrl] { ctrl->run(); });
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&ctrl, p, items] {
+            std::vector<ItemController::ModelPtrC> models;
+            for (int i = 0; i < items; ++i) {
+                auto creator = ctrl->createRequest();
+                creator->producer = p;
+                creator->index = i;
+                models.push_back(creator.toPtr());
+            }
+            // drafts are copied here while the owner thread changes models
+            for (int round = 0; round < 2; ++round) {
+                for (auto && model : models)
+                    ctrl->updateRequest(model)->value += 1;
+            }
+            for (auto && model : models)
+                ctrl->removeRequest(model);
+        });
+    }
+    for (auto && thread : threads)
+        thread.join();
+
+    ctrl->stop();
+    owner.join();
+
+    REQUIRE(view->ordered);
+    REQUIRE(view->createdCount == producers * items);
+    REQUIRE(view->updatedCount == 2 * producers * items);
+    REQUIRE(view->removedCount == producers * items);
+    REQUIRE(ctrl->models().empty());
+}
+
+TEST_CASE("Reentrant requests on the owner thread join the current cascade", "[concurrent]")
+{
+    struct ChainView : ItemView
+    {
+        using ItemView::ItemView;
+    protected:
+        void created(const ModelPtrC & model) override
+        {
+            ItemView::created(model);
+            updateRequest(model)->value += 1;
+        }
+        void updated(const ModelPtrC & model, const ModelPtrC & from) override
+        {
+            ItemView::updated(model, from);
+            removeRequest(model);
+        }
+    };
+
+    auto ctrl = std::make_shared<ItemController>();
+    auto view = std::make_shared<ChainView>(ctrl);
+    view->lastCreated.assign(1, -1);
+
+    std::thread producer([&ctrl] {
+        for (int i = 0; i < 100; ++i)
+            ctrl->createRequest()->index = i;
+    });
+    producer.join();
+
+    REQUIRE(ctrl->processPending() == 100);
+    REQUIRE(view->ordered);
+    REQUIRE(view->createdCount == 100);
+    REQUIRE(view->updatedCount == 100);
+    REQUIRE(view->removedCount == 100);
+    REQUIRE(ctrl->models().empty());
+}
+
+TEST_CASE("Requests queued together are applied in one drain", "[concurrent]")
+{
+    struct BatchView : mvc::details::Observer<Item>
+    {
+        std::vector<size_t> createdBatches;
+        std::vector<size_t> updatedBatches;
+        std::vector<std::pair<int, int>> updates; // from, to
+
+        void createdBatch(const ModelsC & models) override { createdBatches.push_back(models.size()); }
+        void updatedBatch(const Updates & items) override
+        {
+            updatedBatches.push_back(items.size());
+            for (auto && update : items)
+                updates.emplace_back(update.from->value, update.model->value);
+        }
+    };
+
+    ItemController ctrl;
+    ctrl.setOptions(mvc::Option::CoalesceUpdates);
+    BatchView view;
+    ctrl.attach(view);
+
+    const int items = 10;
+    std::vector<ItemController::ModelPtrC> models;
+    std::thread producer([&ctrl, &models, items] {
+        for (int i = 0; i < items; ++i)
+            models.push_back(ctrl.createRequest().toPtr());
+        for (int round = 1; round <= 3; ++round) {
+            for (auto && model : models)
+                ctrl.updateRequest(model)->value = round;
+        }
+    });
+    producer.join();
+
+    REQUIRE(ctrl.processPending() == 4 * items);
+    REQUIRE(view.createdBatches == std::vector<size_t>{items});
+    REQUIRE(view.updatedBatches == std::vector<size_t>{items});
+    REQUIRE(view.updates == std::vector<std::pair<int, int>>(items, {0, 3}));
+
+    auto batch = ctrl.batch();
+    for (auto && model : models)
+        ctrl.removeRequest(model);
+}
+
+TEST_CASE("Batches on the owner thread don't race with drafts of other threads", "[concurrent]")
+{
+    // is meant to be run with -DSANITIZE=thread
+    ItemController ctrl;
+    REQUIRE(ctrl.processPending() == 0); // the test thread becomes the owner
+    auto model = ctrl.createRequest().toPtr();
+
+    std::atomic<bool> done{false};
+    std::thread producer([&ctrl, &model, &done] {
+        for (int i = 0; i < 1000; ++i)
+            ctrl.updateRequest(model)->value += 1; // the model is copied here
+        done = true;
+    });
+    for (int i = 0; !done.load(); ++i) {
+        auto batch = ctrl.batch();
+        ctrl.updateRequest(model)->value = i; // and is swapped with the draft here
+    }
+    producer.join();
+
+    REQUIRE(ctrl.processPending() == 1000);
+    ctrl.removeRequest(model);
+    REQUIRE(ctrl.models().empty());
+}
+
+TEST_CASE("Snapshots are loaded in one batch by concurrent controllers", "[concurrent]")
+{
+    struct CreatedCounter : mvc::details::Observer<Record>
+    {
+        std::vector<size_t> batches;
+        void createdBatch(const ModelsC & models) override { batches.push_back(models.size()); }
+    };
+
+    const std::string path = "mvc_concurrent_snapshot_test.bin";
+    mvc::Controller<Record> source;
+    for (int i = 0; i < 3; ++i)
+        source.createRequest()->value = i;
+    REQUIRE(source.saveSnapshot(path));
+
+    // the owner thread isn't known yet, requests would be queued
+    mvc::ConcurrentController<Record> ctrl;
+    CreatedCounter view;
+    ctrl.attach(view);
+    REQUIRE(ctrl.loadSnapshot(path));
+    REQUIRE(view.batches == std::vector<size_t>{3});
+    REQUIRE(ctrl.models().size() == 3);
+    std::remove(path.c_str());
+
+    REQUIRE(ctrl.processPending() == 0); // the test thread becomes the owner
+    for (mvc::Controller<Record> * controller : {&source, static_cast<mvc::Controller<Record> *>(&ctrl)}) {
+        auto batch = controller->batch();
+        for (auto && model : controller->models())
+            controller->removeRequest(model);
+    }
+    REQUIRE(ctrl.models().empty());
+}
+
+TEST_CASE("Concurrent controllers journal requests of other threads", "[concurrent]")
+{
+    const std::string path = "mvc_concurrent_journal_test.bin";
+    std::remove(path.c_str());
+
+    mvc::ConcurrentController<Record> ctrl;
+    REQUIRE(ctrl.openJournal(path));
+    REQUIRE(ctrl.processPending() == 0); // the test thread becomes the owner
+    auto model = ctrl.createRequest().toPtr();
+
+    // drafts are copied while the owner applies and syncs the records of a pass
+    std::atomic<bool> done{false};
+    std::thread producer([&ctrl, &model, &done] {
+        for (int i = 1; i <= 1000; ++i)
+            ctrl.updateRequest(model)->value = i;
+        done = true;
+    });
+    while (!done.load())
+        ctrl.processPending();
+    producer.join();
+    ctrl.processPending();
+
+    REQUIRE(ctrl.flushJournal());
+    REQUIRE(ctrl.journalStats().records == 1001);
+    ctrl.closeJournal();
+    ctrl.removeRequest(model);
+
+    mvc::Controller<Record> restored;
+    REQUIRE(restored.openJournal(path));
+    REQUIRE((*restored.models().begin())->value == 1000);
+    restored.closeJournal();
+    restored.removeRequest(*restored.models().begin());
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Sharded controller keeps the order of requests of every model", "[concurrent]")
+{
+    struct CountingShard : mvc::ConcurrentController<Item>
+    {
+        std::atomic<int> aboutToUpdateCounter{0};
+    protected:
+        void aboutToUpdate(const ModelPtrC &, const ModelPtr &) override
+        {
+            ++aboutToUpdateCounter;
+        }
+    };
+
+    // Is called from all worker threads
+    struct AtomicView : mvc::details::Observer<Item>
+    {
+        std::atomic<int> createdCount{0};
+        std::atomic<int> removedCount{0};
+        std::atomic<int> unordered{0};
+
+        void created(const ModelPtrC &) override { ++createdCount; }
+        void removed(const ModelPtrC &) override { ++removedCount; }
+        void updated(const ModelPtrC & model, const ModelPtrC & from) override
+        {
+            if (model->value != from->value + 1)
+                ++unordered;
+        }
+    };
+
+    using Sharded = mvc::ShardedController<Item, CountingShard>;
+    Sharded ctrl(4);
+    auto view = std::make_shared<AtomicView>();
+    ctrl.attach(view);
+    ctrl.start();
+
+    const int producers = 4;
+    const int items = 200;
+    std::vector<std::vector<Sharded::ModelPtrC>> models(producers);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&ctrl, &created = models[p], p, items] {
+            for (int i = 0; i < items; ++i) {
+                auto creator = ctrl.createRequest();
+                creator->producer = p;
+                created.push_back(creator.toPtr());
+            }
+        });
+    }
+    for (auto && thread : threads)
+        thread.join();
+
+    ctrl.stop();
+    REQUIRE(ctrl.models().size() == producers * items);
+    size_t iterated = 0;
+    for (auto && model : ctrl.models())
+        iterated += ctrl.models().count(model);
+    REQUIRE(iterated == producers * items);
+    for (auto && shard : ctrl.shards())
+        REQUIRE(shard->models().size() > 0);
+
+    // the update of a model is applied between its create and remove
+    ctrl.start();
+    threads.clear();
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&ctrl, &created = models[p]] {
+            for (auto && model : created) {
+                ctrl.updateRequest(model)->value = 1;
+                ctrl.removeRequest(model);
+            }
+        });
+    }
+    for (auto && thread : threads)
+        thread.join();
+    ctrl.stop();
+
+    int aboutToUpdate = 0;
+    for (auto && shard : ctrl.shards())
+        aboutToUpdate += shard->aboutToUpdateCounter;
+    REQUIRE(aboutToUpdate == producers * items);
+    REQUIRE(view->createdCount == producers * items);
+    REQUIRE(view->removedCount == producers * items);
+    REQUIRE(view->unordered == 0);
+    REQUIRE(ctrl.models().empty());
+}
+
+TEST_CASE("Sharded controller allocates models from the shards' resource", "[concurrent]")
+{
+    // Is used from the producer and the worker threads
+    struct LockedPool : mvc::MemoryResource
+    {
+        std::mutex mutex;
+        mvc::PoolResource pool;
+        size_t allocated = 0;
+
+        void * allocate(size_t bytes, size_t alignment) override
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++allocated;
+            return pool.allocate(bytes, alignment);
+        }
+        void deallocate(void * ptr, size_t bytes, size_t alignment) override
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pool.deallocate(ptr, bytes, alignment);
+        }
+    };
+
+    auto resource = std::make_shared<LockedPool>();
+    mvc::ShardedController<Item> ctrl(2, resource);
+    ctrl.start();
+    std::vector<mvc::ShardedController<Item>::ModelPtrC> models;
+    std::thread producer([&ctrl, &models] {
+        for (int i = 0; i < 10; ++i)
+            models.push_back(ctrl.createRequest().toPtr());
+    });
+    producer.join();
+    ctrl.stop();
+    REQUIRE(ctrl.models().size() == 10);
+    REQUIRE(resource->allocated == 10);
+
+    ctrl.start();
+    for (auto && model : models)
+        ctrl.removeRequest(model);
+    ctrl.stop();
+}
@@ -1,10 +1,18 @@
+#include <chrono>
 #include <vector>
+#include <string>
+#include <thread>
+#include <cstdio>
+#include <type_traits>
 
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 
+#include <mvc/cow.h>
 #include <mvc/view.h>
+#include <mvc/codec.h>
 #include <mvc/controller.h>
+#include <mvc/static_controller.h>
 
 
 struct TestModel
@@ -302,3 +310,1406 @@ TEST_CASE("Views can attached and detached from controller", "[mvc]")
     v1->removeRequest(v1->models[0]);
     REQUIRE(v1->models.size() == 0);
 }
+
+TEST_CASE("Event ring buffer keeps order while wrapping and growing", "[details]")
+{
+    mvc::details::RingBuffer<int> queue;
+    int next = 0, expected = 0;
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 10; ++i)
+            queue.push_back(next++);
+        for (int i = 0; i < 7; ++i)
+            REQUIRE(queue.take_front() == expected++);
+    }
+    const auto capacity = queue.capacity();
+    for (int i = 0; i < 40; ++i)
+        queue.push_back(next++);
+    REQUIRE(queue.capacity() > capacity);
+    while (!queue.empty())
+        REQUIRE(queue.take_front() == expected++);
+    REQUIRE(expected == next);
+}
+
+TEST_CASE("Controller allocates models and drafts from its memory resource", "[mvc]")
+{
+    auto pool = std::make_shared<mvc::PoolResource>();
+    auto ctrl = std::make_shared<mvc::Controller<TestModel>>(pool);
+    auto view = std::make_shared<TestView>(ctrl);
+
+    ctrl->createRequest()->value = 1;
+    auto model = view->models[0];
+    const auto reserved = pool->reserved();
+    REQUIRE(reserved > 0);
+
+    for (int i = 0; i < 10000; ++i)
+        ctrl->updateRequest(model)->value += 1;
+    REQUIRE(model->value == 10001);
+    REQUIRE(pool->reserved() == reserved); // drafts reuse freed blocks
+
+    ctrl->removeRequest(model);
+}
+
+TEST_CASE("Drafts of reentrant updates may outlive the cascade arena", "[mvc]")
+{
+    struct CascadeView: mvc::View<TestModel>
+    {
+        using BaseView = mvc::View<TestModel>;
+        using BaseView::BaseView;
+        std::vector<ModelPtrC> from;
+     protected:
+        void updated(const ModelPtrC & model, const ModelPtrC & prev) override
+        {
+            from.push_back(prev); // keeps drafts allocated in the arena
+            if (model->value % 10)
+                updateRequest(model)->value += 1;
+        }
+    };
+
+    auto ctrl = std::make_shared<TestController>();
+    ctrl->setOptions(mvc::Option::CascadeArena);
+    auto view = std::make_shared<CascadeView>(ctrl);
+
+    ctrl->createRequest()->value = 0;
+    auto model = *ctrl->models().begin();
+    for (int cascade = 0; cascade < 3; ++cascade)
+        ctrl->updateRequest(model)->value += 1;
+
+    REQUIRE(model->value == 30);
+    REQUIRE(view->from.size() == 30);
+    for (int i = 0; i < 30; ++i)
+        REQUIRE(view->from[i]->value == i);
+
+    view->from.clear();
+    ctrl->updateRequest(model)->value += 1;
+    REQUIRE(model->value == 40);
+    ctrl->removeRequest(model);
+}
+
+TEST_CASE("Update drafts share copy-on-write fields until they are changed", "[mvc]")
+{
+    struct Document
+    {
+        int revision = 0;
+        mvc::Cow<std::string> text;
+    };
+
+    auto ctrl = std::make_shared<mvc::Controller<Document>>();
+    {
+        auto creator = ctrl->createRequest();
+        creator->text = std::string(1000, 'a');
+    }
+    auto doc = *ctrl->models().begin();
+
+    {
+        auto updater = ctrl->updateRequest(doc);
+        updater->revision = 1;
+        REQUIRE(updater.toPtr()->text.shares(doc->text));
+    }
+    {
+        auto editor = ctrl->updateRequest(doc);
+        editor->text.edit() += 'b';
+        REQUIRE(!editor.toPtr()->text.shares(doc->text));
+        REQUIRE(doc->text->size() == 1000);
+        REQUIRE(editor.toPtr()->text->size() == 1001);
+    }
+    REQUIRE(doc->revision == 1);
+    REQUIRE(doc->text->size() == 1001);
+
+    ctrl->removeRequest(doc);
+}
+
+TEST_CASE("Batch applies requests at once and notifies views in bulk", "[mvc]")
+{
+    struct BatchView: TestView
+    {
+        using TestView::TestView;
+        std::vector<size_t> createdBatches;
+        std::vector<size_t> updatedBatches;
+        std::vector<size_t> removedBatches;
+     protected:
+        void createdBatch(const ModelsC & models) override
+        {
+            createdBatches.push_back(models.size());
+            TestView::createdBatch(models);
+        }
+        void updatedBatch(const Updates & updates) override
+        {
+            updatedBatches.push_back(updates.size());
+            TestView::updatedBatch(updates);
+        }
+        void removedBatch(const ModelsC & models) override
+        {
+            removedBatches.push_back(models.size());
+            TestView::removedBatch(models);
+        }
+    };
+
+    auto ctrl = std::make_shared<TestController>();
+    auto view = std::make_shared<BatchView>(ctrl);
+    auto plain = std::make_shared<TestView>(ctrl);
+
+    {
+        auto batch = ctrl->batch();
+        for (int i = 0; i < 100; ++i)
+            ctrl->createRequest()->value = i;
+        REQUIRE(ctrl->models().size() == 0);
+        REQUIRE(view->models.size() == 0);
+    }
+    REQUIRE(ctrl->models().size() == 100);
+    REQUIRE(ctrl->aboutToCreateCounter == 100);
+    REQUIRE(view->createdBatches == std::vector<size_t>{100});
+    REQUIRE(view->models.size() == 100);
+    REQUIRE(plain->models.size() == 100);
+
+    {
+        auto batch = view->batch();
+        for (auto && model : ctrl->models())
+            ctrl->updateRequest(model)->value += 1000;
+        ctrl->removeRequest(view->models[0]);
+    }
+    REQUIRE(view->updatedBatches == std::vector<size_t>{100});
+    REQUIRE(view->removedBatches == std::vector<size_t>{1});
+    REQUIRE(plain->log.size() == 100);
+    REQUIRE(plain->models.size() == 99);
+    REQUIRE(ctrl->models().size() == 99);
+
+    {
+        auto batch = ctrl->batch();
+        for (auto && model : ctrl->models())
+            ctrl->removeRequest(model);
+    }
+    REQUIRE(ctrl->models().empty());
+    REQUIRE(view->models.empty());
+    REQUIRE(plain->models.empty());
+}
+
+TEST_CASE("Updates of a model are coalesced until the queue is drained", "[mvc]")
+{
+    struct ChainController : mvc::Controller<TestModel>
+    {
+        bool removeAtEnd = false;
+    protected:
+        void aboutToUpdate(const ModelPtrC & model, const ModelPtr & to) override
+        {
+            if (to->value < 5)
+                updateRequest(model)->value = to->value + 1;
+            else if (removeAtEnd)
+                removeRequest(model);
+        }
+    };
+
+    auto ctrl = std::make_shared<ChainController>();
+    ctrl->setOptions(mvc::Option::CoalesceUpdates);
+    auto view = std::make_shared<TestView>(ctrl);
+
+    ctrl->createRequest()->value = 0;
+    auto model = view->models[0];
+    ctrl->updateRequest(model)->value = 1;
+    REQUIRE(model->value == 5);
+    REQUIRE(view->log.size() == 1);
+    REQUIRE(std::get<1>(view->log[0]) == 0);
+    REQUIRE(std::get<2>(view->log[0]) == 5);
+
+    ctrl->removeAtEnd = true;
+    ctrl->updateRequest(model)->value = 1;
+    REQUIRE(view->log.size() == 2);
+    REQUIRE(std::get<1>(view->log[1]) == 5);
+    REQUIRE(std::get<2>(view->log[1]) == 5);
+    REQUIRE(view->models.empty());
+
+    ctrl->setOptions(0);
+    ctrl->removeAtEnd = false;
+    ctrl->createRequest()->value = 0;
+    ctrl->updateRequest(view->models[0])->value = 1;
+    REQUIRE(view->log.size() == 7);
+    ctrl->removeRequest(view->models[0]);
+}
+
+TEST_CASE("Removal cancels queued create and update requests of the model", "[mvc]")
+{
+    auto ctrl = std::make_shared<TestController>();
+    ctrl->setOptions(mvc::Option::FuseEvents);
+    auto view = std::make_shared<TestView>(ctrl);
+
+    ctrl->createRequest()->value = 1;
+    auto kept = view->models[0];
+    {
+        auto batch = ctrl->batch();
+        TestController::ModelPtrC temporary;
+        {
+            auto creator = ctrl->createRequest();
+            creator->value = 2;
+            temporary = creator.toPtr();
+        }
+        ctrl->updateRequest(temporary)->value = 3;
+        ctrl->updateRequest(kept)->value = 4;
+        ctrl->removeRequest(temporary);
+        ctrl->removeRequest(kept);
+    }
+
+    REQUIRE(ctrl->models().empty());
+    REQUIRE(view->models.empty());
+    REQUIRE(view->log.empty());
+    REQUIRE(ctrl->aboutToCreateCounter == 1);
+    REQUIRE(ctrl->aboutToUpdateCounter == 0);
+    REQUIRE(ctrl->aboutToRemoveCounter == 1);
+    REQUIRE(kept->value == 1);
+}
+
+TEST_CASE("Views are detached by subscription handles and detach themselves when destroyed", "[mvc]")
+{
+    auto ctrl = std::make_shared<TestController>();
+    auto view = std::make_shared<TestView>(ctrl);
+
+    std::vector<std::shared_ptr<TestView>> views;
+    std::vector<TestController::Subscription> subscriptions;
+    for (int i = 0; i < 100; ++i) {
+        auto observer = std::make_shared<TestView>(ctrl);
+        ctrl->detach(observer); // View attaches itself
+        subscriptions.push_back(ctrl->attach(observer));
+        views.push_back(std::move(observer));
+    }
+
+    ctrl->createRequest()->value = 1;
+    for (auto && observer : views)
+        REQUIRE(observer->models.size() == 1);
+
+    for (int i = 0; i < 100; i += 2)
+        ctrl->detach(subscriptions[i]);
+    for (int i = 1; i < 100; i += 4)
+        views[i].reset();
+
+    ctrl->updateRequest(view->models[0])->value = 2;
+    for (int i = 0; i < 100; ++i) {
+        if (views[i] != nullptr)
+            REQUIRE(views[i]->log.size() == (i % 2 ? 1u : 0u));
+    }
+
+    // slots of dropped views are reused
+    views.clear();
+    auto late = std::make_shared<TestView>(ctrl);
+    ctrl->removeRequest(view->models[0]);
+    REQUIRE(late->models.empty());
+    REQUIRE(view->models.empty());
+}
+
+TEST_CASE("Views may be destroyed during notification and outlive the controller", "[mvc]")
+{
+    struct RecordingObserver : mvc::details::Observer<TestModel>
+    {
+        int createdCount = 0;
+        std::function<void()> onCreated;
+
+        void created(const ModelPtrC &) override
+        {
+            ++createdCount;
+            if (onCreated)
+                onCreated();
+        }
+        void removed(const ModelPtrC &) override {}
+        void updated(const ModelPtrC &, const ModelPtrC &) override {}
+    };
+
+    RecordingObserver outliving;
+    {
+        auto ctrl = std::make_shared<TestController>();
+        ctrl->attach(outliving);
+
+        auto first = std::make_unique<RecordingObserver>();
+        auto second = std::make_unique<RecordingObserver>();
+        ctrl->attach(*first);
+        ctrl->attach(*second);
+        first->onCreated = [&second] { second.reset(); };
+
+        auto model = ctrl->createRequest().toPtr();
+        REQUIRE(first->createdCount == 1);
+        REQUIRE(second == nullptr);
+        REQUIRE(outliving.createdCount == 1);
+
+        // a copy isn't attached
+        RecordingObserver copy = outliving;
+        ctrl->removeRequest(model);
+    }
+    // the controller is gone, the observer's destructor has nothing to detach
+}
+
+TEST_CASE("Static controller notifies its own views before attached ones", "[mvc]")
+{
+    struct Log
+    {
+        std::vector<std::string> entries;
+    };
+    static Log log;
+    log.entries.clear();
+
+    struct CreatedView : mvc::StaticView<CreatedView, TestModel>
+    {
+        void created(const ModelPtrC & model)
+        {
+            log.entries.push_back("created " + std::to_string(model->value));
+        }
+    };
+    struct UpdatedView : mvc::StaticView<UpdatedView, TestModel>
+    {
+        int updates = 0;
+        void updated(const ModelPtrC & model, const ModelPtrC & from)
+        {
+            ++updates;
+            log.entries.push_back("updated " + std::to_string(from->value) +
+                                  " " + std::to_string(model->value));
+        }
+    };
+
+    using Ctrl = mvc::StaticController<TestModel, CreatedView, UpdatedView>;
+    auto ctrl = std::make_shared<Ctrl>();
+    auto view = std::make_shared<TestView>(ctrl);
+
+    ctrl->createRequest()->value = 1;
+    REQUIRE(log.entries == std::vector<std::string>{"created 1"});
+    REQUIRE(view->models.size() == 1);
+
+    auto model = view->models[0];
+    {
+        auto batch = ctrl->batch();
+        ctrl->updateRequest(model)->value = 2;
+        ctrl->updateRequest(model)->value = 3;
+    }
+    REQUIRE(ctrl->view<UpdatedView>().updates == 2);
+    REQUIRE(ctrl->view<1>().updates == 2);
+    REQUIRE(log.entries.back() == "updated 2 3");
+    REQUIRE(view->log.size() == 2);
+
+    ctrl->removeRequest(model);
+    REQUIRE(view->models.empty());
+}
+
+TEST_CASE("Moved requests are applied once", "[mvc]")
+{
+    auto ctrl = std::make_shared<TestController>();
+    auto view = std::make_shared<TestView>(ctrl);
+
+    {
+        std::vector<TestController::ModelCreator> creators;
+        for (int i = 0; i < 3; ++i) {
+            auto creator = ctrl->createRequest();
+            creator->value = i;
+            creators.push_back(std::move(creator));
+        }
+        REQUIRE(ctrl->aboutToCreateCounter == 0);
+    }
+    REQUIRE(ctrl->aboutToCreateCounter == 3);
+    REQUIRE(view->models.size() == 3);
+
+    {
+        auto updater = ctrl->updateRequest(view->models[0]);
+        updater->value = 10;
+        auto other = ctrl->updateRequest(view->models[1]);
+        other->value = 11;
+        updater = std::move(other); // both requests stay pending
+    }
+    REQUIRE(ctrl->aboutToUpdateCounter == 2);
+    REQUIRE(view->log.size() == 2);
+
+    {
+        auto remover = ctrl->removeRequest(view->models[2]);
+        auto moved = std::move(remover);
+    }
+    REQUIRE(ctrl->aboutToRemoveCounter == 1);
+
+    auto models = view->models;
+    for (auto && model : models)
+        ctrl->removeRequest(model);
+    REQUIRE(view->models.empty());
+}
+
+TEST_CASE("Slot map reuses slots of erased items with a new generation", "[details]")
+{
+    mvc::details::SlotMap<int> map;
+    std::vector<mvc::details::SlotId> ids;
+    for (int i = 0; i < 10; ++i)
+        ids.push_back(map.insert(i));
+
+    map.erase(ids[3]);
+    map.erase(ids[0]);
+    REQUIRE(map.size() == 8);
+    REQUIRE(map.find(ids[3]) == nullptr);
+    REQUIRE(*map.find(ids[9]) == 9); // moved into a freed position
+
+    auto reused = map.insert(42);
+    REQUIRE(reused.index == ids[0].index);
+    REQUIRE(reused != ids[0]);
+    REQUIRE(map.find(ids[0]) == nullptr);
+    REQUIRE(*map.find(reused) == 42);
+
+    int sum = 0;
+    for (auto value : map)
+        sum += value;
+    REQUIRE(sum == 45 - 3 - 0 + 42);
+}
+
+TEST_CASE("Models are found and changed by their ids", "[mvc]")
+{
+    auto ctrl = std::make_shared<TestController>();
+    auto view = std::make_shared<TestView>(ctrl);
+
+    ctrl->createRequest()->value = 1;
+    ctrl->createRequest()->value = 2;
+    auto first = ctrl->idOf(view->models[0]);
+    auto second = ctrl->idOf(view->models[1]);
+    REQUIRE(first.valid());
+    REQUIRE(ctrl->find(second)->value == 2);
+
+    ctrl->updateRequest(first)->value = 10;
+    REQUIRE(ctrl->find(first)->value == 10);
+
+    // a found model is held by value, creations moving the storage don't affect it
+    auto found = ctrl->find(second);
+    for (int i = 0; i < 100; ++i)
+        ctrl->createRequest()->value = 100 + i;
+    REQUIRE(found->value == 2);
+    while (view->models.size() > 2)
+        ctrl->removeRequest(view->models.back());
+
+    ctrl->removeRequest(first);
+    REQUIRE(ctrl->find(first) == nullptr);
+    REQUIRE(ctrl->find(second) == view->models[0]);
+    REQUIRE(ctrl->idOf(view->models[0]) == second);
+    REQUIRE(*ctrl->models().find(view->models[0]) == view->models[0]);
+
+    ctrl->removeRequest(second);
+    REQUIRE(ctrl->models().empty());
+
+    // erasing a model which isn't in the set does nothing
+    mvc::ModelSet<TestModel> set;
+    auto model = std::make_shared<const TestModel>(TestModel{1});
+    set.erase(model);
+    set.insert(model);
+    set.erase(model);
+    set.erase(model);
+    REQUIRE(set.empty());
+    REQUIRE(set.find(model) == set.end());
+}
+
+TEST_CASE("Single-threaded models are owned by non-atomic pointers", "[mvc]")
+{
+    struct LocalModel
+    {
+        using Ownership = mvc::LocalOwnership;
+        int value = 0;
+    };
+
+    struct LocalView : mvc::View<LocalModel>
+    {
+        using mvc::View<LocalModel>::View;
+        std::vector<ModelPtrC> models;
+        std::vector<std::pair<int, int>> updates;
+
+    protected:
+        void created(const ModelPtrC & model) override { models.push_back(model); }
+        void removed(const ModelPtrC & model) override
+        {
+            models.erase(std::remove(models.begin(), models.end(), model), models.end());
+        }
+        void updated(const ModelPtrC & model, const ModelPtrC & from) override
+        {
+            updates.emplace_back(from->value, model->value);
+        }
+    };
+
+    using LocalController = mvc::Controller<LocalModel>;
+    static_assert(std::is_same<LocalController::ModelPtrC, mvc::LocalPtr<const LocalModel>>::value,
+                  "Local models use LocalPtr");
+
+    auto resource = std::make_shared<mvc::PoolResource>();
+    auto ctrl = std::make_shared<LocalController>(resource);
+    ctrl->setOptions(mvc::Option::CascadeArena | mvc::Option::FuseEvents);
+    auto view = std::make_shared<LocalView>(ctrl);
+
+    ctrl->createRequest()->value = 1;
+    REQUIRE(view->models.size() == 1);
+    auto model = view->models[0];
+    REQUIRE(model.use_count() == 3); // the view, the controller and the copy
+
+    ctrl->updateRequest(model)->value = 2;
+    REQUIRE(model->value == 2);
+    REQUIRE(view->updates == std::vector<std::pair<int, int>>{{1, 2}});
+    REQUIRE(ctrl->find(ctrl->idOf(model)) == model);
+
+    ctrl->removeRequest(model);
+    REQUIRE(view->models.empty());
+    REQUIRE(model.use_count() == 1);
+    model.reset();
+    REQUIRE(resource->used() == 0);
+}
+
+TEST_CASE("Indexes follow created, updated and removed models", "[mvc]")
+{
+    struct Item
+    {
+        std::string name;
+        int rank = 0;
+    };
+    using ItemController = mvc::Controller<Item>;
+
+    auto ctrl = std::make_shared<ItemController>();
+    ctrl->createRequest()->name = "first";
+    auto & byName = ctrl->addIndex(&Item::name);
+    auto & byRank = ctrl->addOrderedIndex(&Item::rank);
+    REQUIRE(byName.find("first") != nullptr);
+    REQUIRE(byRank.count(0) == 1);
+
+    for (int i = 1; i <= 5; ++i) {
+        auto creator = ctrl->createRequest();
+        creator->name = "item";
+        creator->rank = i * 10;
+    }
+    REQUIRE(byName.count("item") == 5);
+    REQUIRE(byName.find("none") == nullptr);
+
+    auto range = byRank.range(15, 40);
+    std::vector<int> ranks;
+    for (auto it = range.first; it != range.second; ++it)
+        ranks.push_back(it->second->rank);
+    REQUIRE(ranks == std::vector<int>{20, 30, 40});
+
+    auto model = byRank.find(30);
+    ctrl->updateRequest(model)->rank = 35;
+    REQUIRE(byRank.find(30) == nullptr);
+    REQUIRE(byRank.find(35) == model);
+    REQUIRE(byName.count("item") == 5);
+
+    ctrl->updateRequest(model)->name = "renamed";
+    REQUIRE(byName.count("item") == 4);
+    REQUIRE(byName.find("renamed") == model);
+
+    ctrl->removeRequest(model);
+    REQUIRE(byName.find("renamed") == nullptr);
+    REQUIRE(byRank.size() == 5);
+
+    // many models with a few keys, the hash index rehashes while they are created
+    for (int i = 0; i < 1000; ++i) {
+        auto creator = ctrl->createRequest();
+        creator->name = i % 2 ? "odd" : "even";
+        creator->rank = i % 3;
+    }
+    std::vector<ItemController::ModelPtrC> odd;
+    for (auto range = byName.equal_range("odd"); range.first != range.second; ++range.first)
+        odd.push_back(range.first->second);
+    for (size_t i = 0; i < odd.size(); ++i) {
+        if (i % 2)
+            ctrl->removeRequest(odd[i]);
+        else
+            ctrl->updateRequest(odd[i])->name = "even";
+    }
+    REQUIRE(byName.count("odd") == 0);
+    REQUIRE(byName.count("even") == 750);
+    REQUIRE(byRank.size() == 755);
+
+    std::vector<ItemController::ModelPtrC> models(ctrl->models().begin(), ctrl->models().end());
+    for (auto && item : models)
+        ctrl->removeRequest(item);
+    REQUIRE(byName.size() == 0);
+    REQUIRE(byRank.size() == 0);
+}
+
+TEST_CASE("Scoped subscriptions receive events of their models only", "[mvc]")
+{
+    struct CountingObserver : mvc::details::Observer<TestModel>
+    {
+        int createdCount = 0;
+        int updatedCount = 0;
+        int removedCount = 0;
+
+        void created(const ModelPtrC &) override { ++createdCount; }
+        void removed(const ModelPtrC &) override { ++removedCount; }
+        void updated(const ModelPtrC &, const ModelPtrC &) override { ++updatedCount; }
+    };
+
+    auto ctrl = std::make_shared<TestController>();
+    auto view = std::make_shared<TestView>(ctrl);
+    for (int i = 0; i < 10; ++i)
+        ctrl->createRequest()->value = i;
+    auto first = view->models[0];
+    auto second = view->models[1];
+
+    CountingObserver single, pair, large;
+    ctrl->attach(single, first);
+    ctrl->attach(pair, first);
+    auto pairSecond = ctrl->attach(pair, second);
+    ctrl->attach(large, [](const TestModel & model) { return model.value >= 100; });
+
+    for (auto && model : view->models)
+        ctrl->updateRequest(model)->value += 1;
+    REQUIRE(single.updatedCount == 1);
+    REQUIRE(pair.updatedCount == 2);
+    REQUIRE(large.updatedCount == 0);
+
+    // a model leaving the predicate is reported too
+    ctrl->updateRequest(second)->value = 100;
+    ctrl->updateRequest(second)->value = 5;
+    ctrl->updateRequest(second)->value = 6;
+    REQUIRE(large.updatedCount == 2);
+    REQUIRE(pair.updatedCount == 5);
+
+    ctrl->detach(pairSecond);
+    {
+        auto batch = ctrl->batch();
+        ctrl->updateRequest(first)->value = 1;
+        ctrl->updateRequest(second)->value = 2;
+        ctrl->createRequest()->value = 200;
+    }
+    REQUIRE(single.updatedCount == 2);
+    REQUIRE(pair.updatedCount == 6);
+    REQUIRE(large.createdCount == 1);
+
+    // subscriptions end with the model
+    ctrl->removeRequest(first);
+    REQUIRE(single.removedCount == 1);
+    REQUIRE(pair.removedCount == 1);
+
+    ctrl->detach(large);
+    auto models = view->models;
+    for (auto && model : models)
+        ctrl->removeRequest(model);
+    REQUIRE(large.removedCount == 0);
+    REQUIRE(single.removedCount == 1);
+
+    // stale handles are ignored, also when their slots are reused by other subscriptions
+    CountingObserver other;
+    auto stale = ctrl->attach(large, TestController::Predicate());
+    ctrl->detach(large);
+    auto reused = ctrl->attach(other, TestController::Predicate());
+    ctrl->detach(stale);
+    auto again = ctrl->attach(large, TestController::Predicate());
+    ctrl->detach(again);
+    ctrl->detach(again);
+    auto plain = ctrl->attach(large);
+    ctrl->detach(large);
+    ctrl->detach(plain);
+    // a handle of an ended subscription doesn't end a later one of the same view
+    auto latest = ctrl->attach(large);
+    ctrl->detach(plain);
+    ctrl->createRequest()->value = 1;
+    REQUIRE(other.createdCount == 1);
+    REQUIRE(large.createdCount == 2);
+    auto created = view->models[0];
+    auto staleModel = ctrl->attach(single, created);
+    ctrl->detach(staleModel);
+    ctrl->attach(single, created);
+    ctrl->detach(staleModel);
+    ctrl->updateRequest(created)->value = 2;
+    REQUIRE(single.updatedCount == 3);
+    ctrl->detach(latest);
+    ctrl->detach(reused);
+    ctrl->removeRequest(created);
+    REQUIRE(other.removedCount == 0);
+    REQUIRE(single.removedCount == 2);
+}
+
+namespace {
+
+struct ReflectedModel
+{
+    int x = 0;
+    int y = 0;
+    mvc::Cow<std::string> text;
+
+    static auto fields() { return mvc::fields(&ReflectedModel::x, &ReflectedModel::y, &ReflectedModel::text); }
+};
+
+} // namespace
+
+TEST_CASE("Views receive masks of changed fields", "[mvc]")
+{
+    struct MaskView : mvc::details::Observer<ReflectedModel>
+    {
+        std::vector<mvc::ChangeMask> masks;
+        void updated(const ModelPtrC &, const ModelPtrC &, mvc::ChangeMask changes) override
+        {
+            masks.push_back(changes);
+        }
+    };
+
+    const auto x = mvc::fieldMask(&ReflectedModel::x);
+    const auto y = mvc::fieldMask(&ReflectedModel::y);
+    const auto text = mvc::fieldMask(&ReflectedModel::text);
+    REQUIRE(x == 1);
+    REQUIRE(mvc::fieldMask(&ReflectedModel::y, &ReflectedModel::text) == (y | text));
+    REQUIRE(mvc::changedFields(TestModel{1}, TestModel{1}) == mvc::AllFields);
+
+    mvc::Controller<ReflectedModel> ctrl;
+    MaskView all, onlyY;
+    ctrl.attach(all);
+    ctrl.attach(onlyY, y);
+
+    auto model = ctrl.createRequest().toPtr();
+    ctrl.updateRequest(model)->x = 1;
+    ctrl.updateRequest(model)->y = 2;
+    {
+        auto updater = ctrl.updateRequest(model);
+        updater->x = 3;
+        updater->text = "text";
+    }
+    ctrl.updateRequest(model); // nothing is changed
+    REQUIRE(all.masks == std::vector<mvc::ChangeMask>{x, y, x | text, 0});
+    REQUIRE(onlyY.masks == std::vector<mvc::ChangeMask>{y});
+
+    {
+        auto batch = ctrl.batch();
+        ctrl.updateRequest(model)->y = 3;
+    }
+    REQUIRE(all.masks.back() == y);
+    REQUIRE(onlyY.masks.size() == 2);
+
+    ctrl.removeRequest(model);
+
+    // static views get masks if their "updated" takes one
+    struct StaticMaskView : mvc::StaticView<StaticMaskView, ReflectedModel>
+    {
+        std::vector<mvc::ChangeMask> masks;
+        void updated(const ModelPtrC &, const ModelPtrC &, mvc::ChangeMask changes) { masks.push_back(changes); }
+    };
+
+    mvc::StaticController<ReflectedModel, StaticMaskView> staticCtrl;
+    model = staticCtrl.createRequest().toPtr();
+    staticCtrl.updateRequest(model)->x = 1;
+    {
+        auto batch = staticCtrl.batch();
+        staticCtrl.updateRequest(model)->text = "text";
+    }
+    REQUIRE(staticCtrl.view<StaticMaskView>().masks == std::vector<mvc::ChangeMask>{x, text});
+    staticCtrl.removeRequest(model);
+}
+
+TEST_CASE("Updates which change nothing are suppressed", "[mvc]")
+{
+    struct ComparableModel
+    {
+        int value = 0;
+        bool operator ==(const ComparableModel & other) const { return value == other.value; }
+    };
+
+    struct CountingController : mvc::Controller<ComparableModel>
+    {
+        int aboutToUpdateCounter = 0;
+        bool increment = false;
+    protected:
+        void aboutToUpdate(const ModelPtrC &, const ModelPtr & to) override
+        {
+            ++aboutToUpdateCounter;
+            if (increment)
+                to->value += 1;
+        }
+    };
+
+    struct UpdateCounter : mvc::details::Observer<ComparableModel>
+    {
+        int updatedCount = 0;
+        void updated(const ModelPtrC &, const ModelPtrC &) override { ++updatedCount; }
+    };
+
+    static_assert(mvc::isComparable<ComparableModel>() && mvc::isComparable<ReflectedModel>() &&
+                  !mvc::isComparable<TestModel>(), "Comparable models are detected");
+
+    CountingController ctrl;
+    ctrl.setOptions(mvc::Option::SuppressNoOpUpdates);
+    UpdateCounter view;
+    ctrl.attach(view);
+
+    auto model = ctrl.createRequest().toPtr();
+    ctrl.updateRequest(model);             // untouched
+    ctrl.updateRequest(model)->value = 0;  // the same value
+    ctrl.updateRequest(model)->value = 1;
+    REQUIRE(ctrl.suppressedUpdates() == 2);
+    REQUIRE(ctrl.aboutToUpdateCounter == 3);
+    REQUIRE(view.updatedCount == 1);
+
+    {
+        auto batch = ctrl.batch();
+        ctrl.updateRequest(model)->value = 1;
+        ctrl.updateRequest(model)->value = 2;
+    }
+    REQUIRE(ctrl.suppressedUpdates() == 3);
+    REQUIRE(view.updatedCount == 2);
+    REQUIRE(model->value == 2);
+
+    // states are compared after the controller has changed the draft
+    ctrl.increment = true;
+    ctrl.updateRequest(model);
+    ctrl.increment = false;
+    REQUIRE(ctrl.suppressedUpdates() == 3);
+    REQUIRE(view.updatedCount == 3);
+    REQUIRE(model->value == 3);
+
+    // reflected models are compared by their fields
+    mvc::Controller<ReflectedModel> reflected;
+    reflected.setOptions(mvc::Option::SuppressNoOpUpdates);
+    auto item = reflected.createRequest().toPtr();
+    reflected.updateRequest(item)->text = "";
+    reflected.updateRequest(item)->y = 1;
+    REQUIRE(reflected.suppressedUpdates() == 1);
+    REQUIRE(item->y == 1);
+
+    // operator == sees fields which aren't in the field list
+    struct PartlyListed
+    {
+        int x = 0;
+        int unlisted = 0;
+        static auto fields() { return mvc::fields(&PartlyListed::x); }
+        bool operator ==(const PartlyListed & other) const { return x == other.x && unlisted == other.unlisted; }
+    };
+
+    struct MaskLog : mvc::details::Observer<PartlyListed>
+    {
+        std::vector<mvc::ChangeMask> masks;
+        void updated(const ModelPtrC &, const ModelPtrC &, mvc::ChangeMask changes) override { masks.push_back(changes); }
+    };
+
+    mvc::Controller<PartlyListed> partly;
+    partly.setOptions(mvc::Option::SuppressNoOpUpdates);
+    MaskLog log;
+    partly.attach(log);
+    auto part = partly.createRequest().toPtr();
+    partly.updateRequest(part)->unlisted = 1;
+    partly.updateRequest(part)->unlisted = 1;
+    REQUIRE(partly.suppressedUpdates() == 1);
+    REQUIRE(part->unlisted == 1);
+    REQUIRE(log.masks == std::vector<mvc::ChangeMask>{0});
+
+    partly.removeRequest(part);
+    reflected.removeRequest(item);
+    ctrl.removeRequest(model);
+}
+
+TEST_CASE("Snapshots restore models in one batch", "[mvc]")
+{
+    struct CreatedCounter : mvc::details::Observer<ReflectedModel>
+    {
+        std::vector<size_t> batches;
+        void createdBatch(const ModelsC & models) override { batches.push_back(models.size()); }
+    };
+
+    struct OtherModel
+    {
+        int x = 0;
+        std::string text;
+
+        static auto fields() { return mvc::fields(&OtherModel::x, &OtherModel::text); }
+    };
+
+    const std::string path = "mvc_snapshot_test.bin";
+
+    mvc::Controller<ReflectedModel> source;
+    for (int i = 0; i < 100; ++i) {
+        auto creator = source.createRequest();
+        creator->x = i;
+        creator->y = -i;
+        creator->text = std::string(static_cast<size_t>(i), 'a');
+    }
+    REQUIRE(source.saveSnapshot(path));
+
+    mvc::Controller<ReflectedModel> target;
+    CreatedCounter view;
+    target.attach(view);
+    auto & byX = target.addIndex(&ReflectedModel::x);
+    REQUIRE(target.loadSnapshot(path));
+    REQUIRE(view.batches == std::vector<size_t>{100});
+    REQUIRE(target.models().size() == 100);
+    for (int i = 0; i < 100; ++i) {
+        auto model = byX.find(i);
+        REQUIRE(model != nullptr);
+        REQUIRE(model->y == -i);
+        REQUIRE(model->text->size() == static_cast<size_t>(i));
+    }
+
+    // models with other fields and damaged files are rejected
+    mvc::Controller<OtherModel> other;
+    REQUIRE_FALSE(other.loadSnapshot(path));
+    {
+        std::FILE * file = std::fopen(path.c_str(), "r+b");
+        REQUIRE(file != nullptr);
+        std::fseek(file, -1, SEEK_END);
+        std::fputc('!', file);
+        std::fputc('!', file); // one byte too many
+        std::fclose(file);
+    }
+    REQUIRE_FALSE(target.loadSnapshot(path));
+    REQUIRE_FALSE(target.loadSnapshot(path + ".missing"));
+    REQUIRE(target.models().size() == 100);
+    std::remove(path.c_str());
+
+    for (auto ctrl : {&source, &target}) {
+        auto batch = ctrl->batch();
+        for (auto && model : ctrl->models())
+            ctrl->removeRequest(model);
+    }
+}
+
+TEST_CASE("Checkpoints keep the state of models at their start", "[mvc]")
+{
+    const std::string path = "mvc_checkpoint_test.bin";
+
+    mvc::Controller<ReflectedModel> ctrl;
+    std::vector<mvc::Controller<ReflectedModel>::ModelPtrC> models;
+    for (int i = 0; i < 1000; ++i) {
+        auto creator = ctrl.createRequest();
+        creator->x = i;
+        creator->text = std::to_string(i);
+        models.push_back(creator.toPtr());
+    }
+
+    REQUIRE(ctrl.checkpoint(path));
+    // changes made while the checkpoint is written don't get into it
+    for (auto && model : models)
+        ctrl.updateRequest(model)->x = -1;
+    for (size_t i = 0; i < models.size(); i += 2)
+        ctrl.removeRequest(models[i]);
+    ctrl.createRequest()->x = -1;
+
+    const auto & stats = ctrl.waitCheckpoint();
+    REQUIRE(stats.ok);
+    REQUIRE(stats.models == 1000);
+    REQUIRE(stats.preserved <= 1000);
+    REQUIRE(stats.bytes > 0);
+    REQUIRE_FALSE(ctrl.checkpointRunning());
+
+    mvc::Controller<ReflectedModel> restored;
+    auto & byX = restored.addIndex(&ReflectedModel::x);
+    REQUIRE(restored.loadSnapshot(path));
+    REQUIRE(restored.models().size() == 1000);
+    REQUIRE(byX.count(-1) == 0);
+    for (int i = 0; i < 1000; ++i)
+        REQUIRE(byX.find(i)->text.get() == std::to_string(i));
+    std::remove(path.c_str());
+
+    for (auto ctrl : {&ctrl, &restored}) {
+        auto batch = ctrl->batch();
+        for (auto && model : ctrl->models())
+            ctrl->removeRequest(model);
+    }
+}
+
+namespace {
+
+long fileSize(const std::string & path)
+{
+    std::FILE * file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return -1;
+    std::fseek(file, 0, SEEK_END);
+    const long size = std::ftell(file);
+    std::fclose(file);
+    return size;
+}
+
+void removeAll(mvc::Controller<ReflectedModel> & ctrl)
+{
+    auto batch = ctrl.batch();
+    for (auto && model : ctrl.models())
+        ctrl.removeRequest(model);
+}
+
+} // namespace
+
+TEST_CASE("Journals replay changes of models", "[mvc]")
+{
+    const std::string path = "mvc_journal_test.bin";
+    std::remove(path.c_str());
+
+    {
+        mvc::Controller<ReflectedModel> ctrl;
+        REQUIRE(ctrl.openJournal(path));
+        auto first = ctrl.createRequest().toPtr();
+        auto second = ctrl.createRequest().toPtr();
+        {
+            auto batch = ctrl.batch();
+            auto updater = ctrl.updateRequest(first);
+            updater->x = 1;
+            updater->text = "first";
+            ctrl.createRequest()->x = 3;
+        }
+        ctrl.updateRequest(first)->y = 2;
+        ctrl.removeRequest(second);
+        // an update which changes no listed field is recorded too
+        REQUIRE(ctrl.flushJournal());
+        const auto records = ctrl.journalStats().records;
+        ctrl.updateRequest(first);
+        REQUIRE(ctrl.flushJournal());
+        REQUIRE(ctrl.journalStats().records == records + 1);
+        // models removed at shutdown mustn't get into the journal
+        ctrl.closeJournal();
+        removeAll(ctrl);
+    }
+
+    struct CreatedCounter : mvc::details::Observer<ReflectedModel>
+    {
+        std::vector<size_t> batches;
+        void createdBatch(const ModelsC & models) override { batches.push_back(models.size()); }
+    };
+
+    {
+        mvc::Controller<ReflectedModel> ctrl;
+        CreatedCounter view;
+        ctrl.attach(view);
+        auto & byX = ctrl.addIndex(&ReflectedModel::x);
+        REQUIRE(ctrl.openJournal(path));
+        REQUIRE(view.batches == std::vector<size_t>{2});
+        REQUIRE(ctrl.models().size() == 2);
+        auto first = byX.find(1);
+        REQUIRE(first != nullptr);
+        REQUIRE(first->y == 2);
+        REQUIRE(first->text.get() == "first");
+        REQUIRE(byX.count(3) == 1);
+
+        // new records are appended to the replayed ones
+        ctrl.updateRequest(first)->x = 10;
+        ctrl.removeRequest(byX.find(3));
+        ctrl.closeJournal();
+        removeAll(ctrl);
+    }
+
+    // a record cut by a crash is dropped
+    const long size = fileSize(path);
+    {
+        std::FILE * file = std::fopen(path.c_str(), "ab");
+        REQUIRE(file != nullptr);
+        std::fputs("torn", file);
+        std::fclose(file);
+    }
+
+    {
+        mvc::Controller<ReflectedModel> ctrl;
+        REQUIRE(ctrl.openJournal(path));
+        REQUIRE(fileSize(path) == size);
+        REQUIRE(ctrl.models().size() == 1);
+        auto model = *ctrl.models().begin();
+        REQUIRE(model->x == 10);
+        REQUIRE(model->y == 2);
+
+        for (int i = 0; i < 100; ++i)
+            ctrl.updateRequest(model)->y = i;
+        REQUIRE(ctrl.compactJournal());
+        REQUIRE(fileSize(path) < size);
+        ctrl.closeJournal();
+        removeAll(ctrl);
+    }
+
+    {
+        mvc::Controller<ReflectedModel> ctrl;
+        REQUIRE(ctrl.openJournal(path));
+        REQUIRE(ctrl.models().size() == 1);
+        REQUIRE((*ctrl.models().begin())->y == 99);
+        ctrl.closeJournal();
+        removeAll(ctrl);
+    }
+
+    struct OtherModel
+    {
+        int x = 0;
+
+        static auto fields() { return mvc::fields(&OtherModel::x); }
+    };
+    mvc::Controller<OtherModel> other;
+    REQUIRE_FALSE(other.openJournal(path));
+
+    // a file shorter than the header is started anew
+    {
+        std::FILE * file = std::fopen(path.c_str(), "wb");
+        REQUIRE(file != nullptr);
+        std::fputs("MVC", file);
+        std::fclose(file);
+    }
+    for (int i = 0; i < 2; ++i) {
+        mvc::Controller<ReflectedModel> ctrl;
+        REQUIRE(ctrl.openJournal(path));
+        REQUIRE(ctrl.models().size() == static_cast<size_t>(i));
+        ctrl.createRequest()->x = 5;
+        REQUIRE(ctrl.flushJournal());
+        ctrl.closeJournal();
+        removeAll(ctrl);
+    }
+
+    // an intact record which doesn't fit the models isn't cut off with the records after it
+    {
+        std::remove(path.c_str());
+        mvc::Controller<ReflectedModel> ctrl;
+        REQUIRE(ctrl.openJournal(path));
+        ctrl.createRequest()->x = 1;
+        auto model = ctrl.createRequest().toPtr();
+        REQUIRE(ctrl.flushJournal());
+        const long before = fileSize(path);
+        ctrl.removeRequest(model);
+        REQUIRE(ctrl.flushJournal());
+        ctrl.closeJournal();
+        removeAll(ctrl);
+
+        // the removal is appended once more, it removes a model which isn't there
+        std::FILE * file = std::fopen(path.c_str(), "rb+");
+        REQUIRE(file != nullptr);
+        std::vector<char> removal(static_cast<size_t>(fileSize(path) - before));
+        std::fseek(file, before, SEEK_SET);
+        REQUIRE(std::fread(removal.data(), 1, removal.size(), file) == removal.size());
+        std::fseek(file, 0, SEEK_END);
+        std::fwrite(removal.data(), 1, removal.size(), file);
+        std::fclose(file);
+    }
+    const long damaged = fileSize(path);
+    {
+        mvc::Controller<ReflectedModel> ctrl;
+        REQUIRE_FALSE(ctrl.openJournal(path));
+        REQUIRE(ctrl.models().empty());
+        REQUIRE(fileSize(path) == damaged);
+    }
+    std::remove(path.c_str());
+
+    // effects of "aboutTo" callbacks are journaled, they aren't repeated by the replay
+    struct ParentController : mvc::Controller<ReflectedModel>
+    {
+        int aboutToCreateCounter = 0;
+    protected:
+        void aboutToCreate(const ModelPtr & model) override
+        {
+            ++aboutToCreateCounter;
+            if (model->x == 1)
+                createRequest()->x = 2; // a child of the model
+        }
+    };
+    for (int i = 0; i < 3; ++i) {
+        ParentController ctrl;
+        REQUIRE(ctrl.openJournal(path));
+        if (i == 0)
+            ctrl.createRequest()->x = 1;
+        REQUIRE(ctrl.models().size() == 2);
+        REQUIRE(ctrl.aboutToCreateCounter == (i == 0 ? 2 : 0));
+        ctrl.closeJournal();
+        removeAll(ctrl);
+    }
+    std::remove(path.c_str());
+
+    // a file which can't be read isn't taken for a missing journal
+    {
+        mvc::Controller<ReflectedModel> ctrl;
+        REQUIRE_FALSE(ctrl.openJournal("."));
+    }
+}
+
+TEST_CASE("Journals group records by the sync policy", "[mvc]")
+{
+    const std::string path = "mvc_journal_sync_test.bin";
+    std::remove(path.c_str());
+
+    mvc::Controller<ReflectedModel> ctrl;
+    mvc::JournalOptions options;
+    options.sync = mvc::JournalOptions::Sync::Interval;
+    options.interval = std::chrono::hours(1);
+    auto model = ctrl.createRequest().toPtr();
+    REQUIRE(ctrl.openJournal(path, options));
+    // the existing model is recorded at once
+    const long size = fileSize(path);
+
+    for (int i = 1; i <= 10; ++i)
+        ctrl.updateRequest(model)->x = i;
+    REQUIRE(fileSize(path) == size);
+    REQUIRE(ctrl.journalStats().records == 1);
+    REQUIRE(ctrl.flushJournal());
+    REQUIRE(fileSize(path) > size);
+    REQUIRE(ctrl.journalStats().records == 11);
+
+    ctrl.closeJournal();
+    removeAll(ctrl);
+
+    mvc::Controller<ReflectedModel> restored;
+    REQUIRE(restored.openJournal(path));
+    REQUIRE((*restored.models().begin())->x == 10);
+    restored.closeJournal();
+    removeAll(restored);
+
+    // records are written by a background thread when no more requests come
+    mvc::Controller<ReflectedModel> idle;
+    options.interval = std::chrono::milliseconds(10);
+    REQUIRE(idle.openJournal(path, options));
+    const long replayed = fileSize(path);
+    idle.updateRequest(*idle.models().begin())->x = 20;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (idle.journalStats().records == 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    REQUIRE(fileSize(path) > replayed);
+    const auto stats = idle.journalStats();
+    REQUIRE(stats.ok);
+    REQUIRE(stats.records == 1);
+    REQUIRE(stats.dropped == 0);
+    idle.closeJournal();
+    removeAll(idle);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Encoded models are read in place", "[mvc]")
+{
+    ReflectedModel model;
+    model.x = 7;
+    model.y = -3;
+    model.text = "encoded";
+
+    std::vector<char> buffer;
+    mvc::encode(buffer, model);
+    const size_t first = buffer.size();
+    model.text = std::string(1000, 'z');
+    mvc::encode(buffer, model, mvc::fieldMask(&ReflectedModel::text));
+
+    mvc::RecordView<ReflectedModel> record(buffer.data(), buffer.size());
+    REQUIRE(record.valid());
+    REQUIRE(record.size() == first);
+    REQUIRE(record.get(&ReflectedModel::x) == 7);
+    REQUIRE(record.get(&ReflectedModel::y) == -3);
+    REQUIRE(record.get(&ReflectedModel::text) == std::string("encoded"));
+    REQUIRE(record.get(&ReflectedModel::text).data > buffer.data()); // points into the buffer
+
+    mvc::RecordView<ReflectedModel> update(buffer.data() + first, buffer.size() - first,
+                                           mvc::fieldMask(&ReflectedModel::text));
+    REQUIRE(update.valid());
+    REQUIRE(update.has(&ReflectedModel::text));
+    REQUIRE_FALSE(update.has(&ReflectedModel::x));
+    REQUIRE(update.get(&ReflectedModel::text).size == 1000);
+
+    ReflectedModel decoded;
+    record.decode(decoded);
+    REQUIRE(mvc::sameState(decoded, ReflectedModel{7, -3, std::string("encoded")}));
+    update.decode(decoded);
+    REQUIRE(decoded.x == 7);
+    REQUIRE(decoded.text.get() == std::string(1000, 'z'));
+
+    // records which don't fit into the data are broken
+    REQUIRE_FALSE(mvc::RecordView<ReflectedModel>(buffer.data(), first - 1).valid());
+    buffer[first + sizeof(uint32_t) + 3] = 0x7f; // the offset of the text is out of the record
+    REQUIRE_FALSE(mvc::RecordView<ReflectedModel>(buffer.data() + first, buffer.size() - first,
+                                                  mvc::fieldMask(&ReflectedModel::text)).valid());
+}
+
+namespace {
+
+struct IntModel
+{
+    int value = 0;
+    static auto fields() { return mvc::fields(&IntModel::value); }
+};
+
+struct FloatModel
+{
+    float value = 0;
+    static auto fields() { return mvc::fields(&FloatModel::value); }
+};
+
+} // namespace
+
+namespace {
+
+enum class Level : uint8_t { Low, High };
+enum Color { Red, Green, Blue };
+
+struct Point
+{
+    int16_t x;
+    int16_t y;
+};
+
+struct CheckedModel
+{
+    bool flag = false;
+    Level level = Level::Low;
+    Color color = Red;
+    Point point{0, 0};
+
+    static auto fields()
+    {
+        return mvc::fields(&CheckedModel::flag, &CheckedModel::level, &CheckedModel::color, &CheckedModel::point);
+    }
+};
+
+} // namespace
+
+namespace mvc {
+
+template<>
+struct EnumRange<Color>
+{
+    static constexpr Color min = Red, max = Blue;
+};
+
+template<>
+struct TriviallyEncoded<Point> : std::true_type {};
+
+} // namespace mvc
+
+TEST_CASE("Encoded values are checked when they are read", "[mvc]")
+{
+    CheckedModel model;
+    model.flag = true;
+    model.level = Level::High;
+    model.color = Blue;
+    model.point = {3, -4};
+
+    std::vector<char> buffer;
+    REQUIRE(mvc::encode(buffer, model));
+    mvc::RecordView<CheckedModel> record(buffer.data(), buffer.size());
+    REQUIRE(record.valid());
+    CheckedModel decoded;
+    record.decode(decoded);
+    REQUIRE(decoded.flag);
+    REQUIRE(decoded.level == Level::High);
+    REQUIRE(decoded.color == Blue);
+    REQUIRE(decoded.point.x == 3);
+    REQUIRE(decoded.point.y == -4);
+
+    const size_t flag = sizeof(uint32_t);
+    const size_t level = flag + sizeof(bool);
+    const size_t color = level + sizeof(Level);
+    auto validWith = [&buffer](size_t offset, char byte) {
+        auto damaged = buffer;
+        damaged[offset] = byte;
+        return mvc::RecordView<CheckedModel>(damaged.data(), damaged.size()).valid();
+    };
+    REQUIRE_FALSE(validWith(flag, 2));           // not a bool
+    REQUIRE_FALSE(validWith(color, Blue + 1));   // out of the range of the enum
+    REQUIRE(validWith(level, 7));                // any value of the underlying type of a scoped enum
+}
+
+TEST_CASE("Schemas tell field types of the same size apart", "[mvc]")
+{
+    REQUIRE(mvc::details::schemaOf<IntModel>() != mvc::details::schemaOf<FloatModel>());
+    REQUIRE(mvc::FieldCodec<int32_t>::signature() != mvc::FieldCodec<uint32_t>::signature());
+    REQUIRE(mvc::FieldCodec<bool>::signature() != mvc::FieldCodec<uint8_t>::signature());
+    REQUIRE(mvc::FieldCodec<double>::signature() != mvc::FieldCodec<int64_t>::signature());
+}
+
+TEST_CASE("Encoded events round trip", "[mvc]")
+{
+    ReflectedModel model;
+    model.x = 1;
+    model.y = 2;
+
+    const auto y = mvc::fieldMask(&ReflectedModel::y);
+    std::vector<char> buffer;
+    mvc::encodeEvent(buffer, mvc::EventType::Create, 10, &model);
+    mvc::encodeEvent(buffer, mvc::EventType::Update, 10, &model, y);
+    mvc::encodeEvent<ReflectedModel>(buffer, mvc::EventType::Remove, 10);
+
+    std::vector<mvc::EventType> types;
+    const char * pos = buffer.data();
+    const char * end = buffer.data() + buffer.size();
+    while (pos != end) {
+        mvc::EventView<ReflectedModel> event(pos, static_cast<size_t>(end - pos));
+        REQUIRE(event.valid());
+        REQUIRE(event.key() == 10);
+        types.push_back(event.type());
+        if (event.type() == mvc::EventType::Create)
+            REQUIRE(event.model().get(&ReflectedModel::x) == 1);
+        if (event.type() == mvc::EventType::Update) {
+            REQUIRE(event.model().fields() == y);
+            REQUIRE(event.model().get(&ReflectedModel::y) == 2);
+        }
+        pos += event.size();
+    }
+    REQUIRE(types == std::vector<mvc::EventType>{mvc::EventType::Create, mvc::EventType::Update,
+                                                 mvc::EventType::Remove});
+    REQUIRE_FALSE(mvc::EventView<ReflectedModel>(buffer.data(), 5).valid());
+}